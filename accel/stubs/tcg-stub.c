@@ -17,6 +17,10 @@ void tb_flush(CPUState *cpu)
 {
 }
 
+void tb_prefetch_add(target_ulong start, target_ulong end)
+{
+}
+
 void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
 {
 }
@@ -334,6 +334,12 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     return tb->tc.ptr;
 }
 
+/* Called by a TB that just reached the superblock threshold */
+void HELPER(tb_hot)(void *tb)
+{
+    tb_mark_hot(tb);
+}
+
 /* Execute a TB, and fix up the CPU state afterwards if necessary */
 /*
  * Disable CFI checks.
@@ -898,6 +904,11 @@ int cpu_exec(CPUState *cpu)
     current_cpu = cpu;
 
     if (cpu_handle_halt(cpu)) {
+#ifdef CONFIG_SOFTMMU
+        if (unlikely(qatomic_read(&tb_prefetch_pending))) {
+            tb_prefetch_idle(cpu);
+        }
+#endif
         return EXCP_HALTED;
     }
 
@@ -2,8 +2,73 @@
 #include "qemu/error-report.h"
 #include "qapi/error.h"
 #include "qapi/qapi-commands-machine.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qerror.h"
 #include "exec/exec-all.h"
+#include "monitor/hmp.h"
 #include "monitor/monitor.h"
+#include "internal.h"
+
+void hmp_tb_stats(Monitor *mon, const QDict *qdict)
+{
+    const char *op = qdict_get_try_str(qdict, "op");
+    Error *err = NULL;
+
+    if (op == NULL) {
+        monitor_printf(mon, "tb-stats is %s\n",
+                       !tb_stats_enabled ? "off" :
+                       tb_stats_exec_enabled ? "on, counting executions" :
+                       "on");
+        return;
+    }
+    if (!strcmp(op, "on")) {
+        qmp_x_tb_stats(true, false, false, false, false, &err);
+    } else if (!strcmp(op, "exec")) {
+        qmp_x_tb_stats(true, true, true, false, false, &err);
+    } else if (!strcmp(op, "off")) {
+        qmp_x_tb_stats(false, false, false, false, false, &err);
+    } else if (!strcmp(op, "reset")) {
+        qmp_x_tb_stats(tb_stats_enabled, true, tb_stats_exec_enabled,
+                       true, true, &err);
+    } else {
+        error_setg(&err, QERR_INVALID_PARAMETER, op);
+    }
+    hmp_handle_error(mon, err);
+}
+
+void hmp_info_tb_stats(Monitor *mon, const QDict *qdict)
+{
+    int64_t max = qdict_get_try_int(qdict, "max", INT64_MAX);
+    TbSymbolStatsList *list, *l;
+    Error *err = NULL;
+
+    list = qmp_x_query_tb_stats(&err);
+    if (hmp_handle_error(mon, err)) {
+        return;
+    }
+    if (!list) {
+        monitor_printf(mon, "No translations recorded%s\n",
+                       tb_stats_enabled ? "" :
+                       " (enable with 'tb-stats on')");
+        return;
+    }
+
+    monitor_printf(mon, "%8s %10s %10s %12s %12s %8s %8s  %s\n",
+                   "TBs", "Guest", "Host", "Translate ms", "Executions",
+                   "Inval", "Flushed", "Symbol");
+    for (l = list; l && max-- > 0; l = l->next) {
+        TbSymbolStats *s = l->value;
+        g_autofree char *executions = s->has_executions ?
+            g_strdup_printf("%" PRId64, s->executions) : g_strdup("-");
+
+        monitor_printf(mon, "%8" PRId64 " %10" PRId64 " %10" PRId64
+                       " %12.3f %12s %8" PRId64 " %8" PRId64 "  %s\n",
+                       s->tbs, s->guest_bytes, s->code_bytes,
+                       s->translate_ns / 1e6, executions,
+                       s->invalidations, s->flushes, s->symbol);
+    }
+    qapi_free_TbSymbolStatsList(list);
+}
 
 static void hmp_tcg_register(void)
 {
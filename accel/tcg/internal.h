@@ -18,4 +18,19 @@ G_NORETURN void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr);
 void page_init(void);
 void tb_htable_init(void);
 
+extern uint32_t tb_hot_threshold;
+bool tb_is_hot(const TranslationBlock *tb);
+void tb_mark_hot(TranslationBlock *tb);
+
+#ifdef CONFIG_SOFTMMU
+extern bool tb_prefetch_pending;
+void tb_prefetch_idle(CPUState *cpu);
+extern bool tb_stats_enabled;
+extern bool tb_stats_exec_enabled;
+uint64_t *tb_stats_exec_counter(target_ulong pc);
+void tb_stats_translated(TranslationBlock *tb, int64_t ns);
+void tb_stats_invalidated(TranslationBlock *tb);
+void tb_stats_flushed(void);
+#endif
+
 #endif /* ACCEL_TCG_INTERNAL_H */
@@ -91,6 +91,19 @@ void HELPER(plugin_vcpu_mem_cb)(unsigned int vcpu_index,
                                 void *userdata)
 { }
 
+/*
+ * Never called either: only their descriptions, which let TCG sync the
+ * globals first, replace those of the stubs above when a callback reads
+ * the registers.
+ */
+void HELPER(plugin_vcpu_udata_cb_r)(uint32_t cpu_index, void *udata)
+{ }
+
+void HELPER(plugin_vcpu_mem_cb_r)(unsigned int vcpu_index,
+                                  qemu_plugin_meminfo_t info, uint64_t vaddr,
+                                  void *userdata)
+{ }
+
 static void do_gen_mem_cb(TCGv vaddr, uint32_t info)
 {
     TCGv_i32 cpu_index = tcg_temp_new_i32();
@@ -378,8 +391,12 @@ static TCGOp *copy_st_ptr(TCGOp **begin_op, TCGOp *op)
     return op;
 }
 
+/*
+ * @helper is the stub whose flags the call gets: @empty_func, or its
+ * variant for callbacks that read the registers.
+ */
 static TCGOp *copy_call(TCGOp **begin_op, TCGOp *op, void *empty_func,
-                        void *func, int *cb_idx)
+                        void *helper, void *func, int *cb_idx)
 {
     /* copy all ops until the call */
     do {
@@ -406,7 +423,11 @@ static TCGOp *copy_call(TCGOp **begin_op, TCGOp *op, void *empty_func,
         tcg_debug_assert(i < MAX_OPC_PARAM_ARGS);
     }
     op->args[*cb_idx] = (uintptr_t)func;
-    op->args[*cb_idx + 1] = (*begin_op)->args[*cb_idx + 1];
+    if (helper == empty_func) {
+        op->args[*cb_idx + 1] = (*begin_op)->args[*cb_idx + 1];
+    } else {
+        op->args[*cb_idx + 1] = tcg_helper_info_arg(helper);
+    }
 
     return op;
 }
@@ -433,6 +454,9 @@ static TCGOp *append_udata_cb(const struct qemu_plugin_dyn_cb *cb,
 
     /* call */
     op = copy_call(&begin_op, op, HELPER(plugin_vcpu_udata_cb),
+                   cb->flags == QEMU_PLUGIN_CB_NO_REGS ?
+                   HELPER(plugin_vcpu_udata_cb) :
+                   HELPER(plugin_vcpu_udata_cb_r),
                    cb->f.vcpu_udata, cb_idx);
 
     return op;
@@ -484,6 +508,9 @@ static TCGOp *append_mem_cb(const struct qemu_plugin_dyn_cb *cb,
     if (type == PLUGIN_GEN_CB_MEM) {
         /* call */
         op = copy_call(&begin_op, op, HELPER(plugin_vcpu_mem_cb),
+                       cb->flags == QEMU_PLUGIN_CB_NO_REGS ?
+                       HELPER(plugin_vcpu_mem_cb) :
+                       HELPER(plugin_vcpu_mem_cb_r),
                        cb->f.vcpu_udata, cb_idx);
     }
 
@@ -0,0 +1,183 @@
+/*
+ * Ahead of time translation of ROM code
+ *
+ * Boards can queue ranges of ROM code, such as the functions of their
+ * firmware, for TCG to translate while the vCPU is idle, so that code
+ * the guest has never run is ready when it needs it.  The ranges are
+ * swept linearly while the vCPU is halted, using the TB flags of the
+ * state it sleeps in, which are those of most of the code that runs when
+ * it wakes up.  Translating data or a block with other flags only costs
+ * some code buffer space.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/memory.h"
+#include "exec/ramblock.h"
+#include "sysemu/cpus.h"
+#include "sysemu/tcg.h"
+#include "internal.h"
+#include "trace.h"
+
+static bool tb_prefetch_page_is_rom(tb_page_addr_t page)
+{
+    ram_addr_t offset;
+    RAMBlock *rb;
+
+    rb = qemu_ram_block_from_host(qemu_map_ram_ptr(NULL, page), false,
+                                  &offset);
+    return rb && memory_region_is_rom(rb->mr);
+}
+
+/*
+ * Translate a block of ROM code ahead of time, without any effect on the
+ * guest: the pages of the block, and the next one which its last insn
+ * may straddle, are probed first and must be executable ROM.  Returns
+ * NULL if this is not the case.
+ */
+static TranslationBlock *tb_prefetch_translate(CPUState *cpu, target_ulong pc,
+                                               target_ulong cs_base,
+                                               uint32_t flags, uint32_t cflags)
+{
+    CPUArchState *env = cpu->env_ptr;
+    TranslationBlock *tb;
+    target_ulong addr[2] = { pc, (pc & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE };
+    tb_page_addr_t page;
+    void *host;
+    int i;
+
+    tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
+    if (tb) {
+        return tb;
+    }
+    for (i = 0; i < ARRAY_SIZE(addr); i++) {
+        if (probe_access_flags(env, addr[i], MMU_INST_FETCH,
+                               cpu_mmu_index(env, true), true, &host, 0)
+            & TLB_INVALID_MASK) {
+            return NULL;
+        }
+        page = get_page_addr_code(env, addr[i]);
+        if (page == -1 || !tb_prefetch_page_is_rom(page)) {
+            return NULL;
+        }
+    }
+
+    mmap_lock();
+    tb = tb_gen_code(cpu, pc, cs_base, flags, cflags);
+    mmap_unlock();
+    return tb;
+}
+
+#define TB_PREFETCH_BUDGET_NS (5 * SCALE_MS)
+
+typedef struct TBPrefetchRange {
+    target_ulong start;
+    target_ulong end;
+} TBPrefetchRange;
+
+static struct {
+    QemuMutex lock;
+    GArray *ranges;
+    guint next;
+    target_ulong pc;
+    int translated;
+} tb_prefetch;
+
+bool tb_prefetch_pending;
+
+void tb_prefetch_add(target_ulong start, target_ulong end)
+{
+    TBPrefetchRange r = { .start = start, .end = end };
+
+    if (!tcg_enabled() || start >= end) {
+        return;
+    }
+    if (!tb_prefetch.ranges) {
+        qemu_mutex_init(&tb_prefetch.lock);
+        tb_prefetch.ranges = g_array_new(false, false,
+                                         sizeof(TBPrefetchRange));
+    }
+    qemu_mutex_lock(&tb_prefetch.lock);
+    g_array_append_val(tb_prefetch.ranges, r);
+    if (tb_prefetch.next == tb_prefetch.ranges->len - 1) {
+        tb_prefetch.pc = start;
+    }
+    qatomic_set(&tb_prefetch_pending, true);
+    qemu_mutex_unlock(&tb_prefetch.lock);
+}
+
+static bool tb_prefetch_should_stop(CPUState *cpu, int64_t deadline)
+{
+    return !cpu_thread_is_idle(cpu) || qatomic_read(&cpu->exit_request) ||
+           qemu_clock_get_ns(QEMU_CLOCK_REALTIME) > deadline;
+}
+
+static void tb_prefetch_step(CPUState *cpu, target_ulong cs_base,
+                             uint32_t flags, uint32_t cflags)
+{
+    TBPrefetchRange r;
+    TranslationBlock *tb;
+    target_ulong pc;
+
+    qemu_mutex_lock(&tb_prefetch.lock);
+    r = g_array_index(tb_prefetch.ranges, TBPrefetchRange, tb_prefetch.next);
+    pc = tb_prefetch.pc;
+    qemu_mutex_unlock(&tb_prefetch.lock);
+
+    tb = tb_prefetch_translate(cpu, pc, cs_base, flags, cflags);
+    if (tb) {
+        pc += tb->size;
+        tb_prefetch.translated++;
+    } else {
+        /* Not executable ROM, try the next page */
+        pc = (pc & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE;
+    }
+
+    qemu_mutex_lock(&tb_prefetch.lock);
+    if (pc >= r.end || pc <= r.start) {
+        if (++tb_prefetch.next == tb_prefetch.ranges->len) {
+            qatomic_set(&tb_prefetch_pending, false);
+            trace_tb_prefetch_done(tb_prefetch.next, tb_prefetch.translated);
+        } else {
+            pc = g_array_index(tb_prefetch.ranges, TBPrefetchRange,
+                               tb_prefetch.next).start;
+        }
+    }
+    tb_prefetch.pc = pc;
+    qemu_mutex_unlock(&tb_prefetch.lock);
+}
+
+/* Called by a halted vCPU, outside of cpu_exec()'s main loop */
+void tb_prefetch_idle(CPUState *cpu)
+{
+    int64_t deadline = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) +
+                       TB_PREFETCH_BUDGET_NS;
+    target_ulong pc, cs_base;
+    uint32_t flags, cflags;
+
+    cpu_get_tb_cpu_state(cpu->env_ptr, &pc, &cs_base, &flags);
+    cflags = curr_cflags(cpu);
+
+    rcu_read_lock();
+    if (sigsetjmp(cpu->jmp_env, 0) != 0) {
+        /*
+         * The code buffer is full and a flush is queued: translating
+         * more would only evict the blocks that are actually used.
+         */
+        rcu_read_unlock();
+        qatomic_set(&tb_prefetch_pending, false);
+        return;
+    }
+    while (qatomic_read(&tb_prefetch_pending) &&
+           !tb_prefetch_should_stop(cpu, deadline)) {
+        tb_prefetch_step(cpu, cs_base, flags, cflags);
+    }
+    rcu_read_unlock();
+}
@@ -0,0 +1,212 @@
+/*
+ * Translation statistics per guest symbol
+ *
+ * While enabled, every TB that is translated, invalidated or discarded
+ * by a flush is accounted to the guest function it starts in, as found
+ * in the symbol tables of the loaded ELF images (see lookup_symbol()).
+ * Code outside any known function is grouped by page.  This shows which
+ * functions are translated over and over again, for instance because
+ * they are invalidated by writes to their page or because their blocks
+ * can no longer be chained and the cache fills up.
+ *
+ * Counting executions is optional, as it requires instrumenting the
+ * translated code: each TB then increments the counter of its function
+ * when it is entered, including through a chained jump.  The increment
+ * is not atomic, so the count is approximate with MTTCG.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-machine.h"
+#include "qemu/thread.h"
+#include "cpu.h"
+#include "disas/disas.h"
+#include "exec/exec-all.h"
+#include "hw/core/cpu.h"
+#include "sysemu/tcg.h"
+#include "tcg/tcg.h"
+#include "internal.h"
+
+typedef struct TBSymbolStats {
+    char *symbol;
+    uint64_t tbs;
+    uint64_t guest_bytes;
+    uint64_t code_bytes;
+    uint64_t translate_ns;
+    /* Incremented by the translated code, see gen_tb_stats_exec() */
+    uint64_t executions;
+    uint64_t invalidations;
+    uint64_t flushes;
+} TBSymbolStats;
+
+bool tb_stats_enabled;
+bool tb_stats_exec_enabled;
+
+/*
+ * Entries are never freed, even on reset, because the translated code
+ * holds pointers to their execution counter.
+ */
+static QemuMutex tb_stats_lock;
+static GHashTable *tb_stats_table;
+static bool tb_stats_exec_counted;
+
+static TBSymbolStats *tb_stats_get(target_ulong pc)
+{
+    const char *symbol = lookup_symbol(pc);
+    g_autofree char *page = NULL;
+    TBSymbolStats *s;
+
+    if (!symbol[0]) {
+        page = g_strdup_printf("[" TARGET_FMT_lx "]", pc & TARGET_PAGE_MASK);
+        symbol = page;
+    }
+    s = g_hash_table_lookup(tb_stats_table, symbol);
+    if (!s) {
+        s = g_new0(TBSymbolStats, 1);
+        s->symbol = g_strdup(symbol);
+        g_hash_table_insert(tb_stats_table, s->symbol, s);
+    }
+    return s;
+}
+
+uint64_t *tb_stats_exec_counter(target_ulong pc)
+{
+    TBSymbolStats *s;
+
+    qemu_mutex_lock(&tb_stats_lock);
+    s = tb_stats_get(pc);
+    qemu_mutex_unlock(&tb_stats_lock);
+    return &s->executions;
+}
+
+void tb_stats_translated(TranslationBlock *tb, int64_t ns)
+{
+    TBSymbolStats *s;
+
+    qemu_mutex_lock(&tb_stats_lock);
+    s = tb_stats_get(tb->pc);
+    s->tbs++;
+    s->guest_bytes += tb->size;
+    s->code_bytes += tb->tc.size;
+    s->translate_ns += ns;
+    qemu_mutex_unlock(&tb_stats_lock);
+}
+
+void tb_stats_invalidated(TranslationBlock *tb)
+{
+    qemu_mutex_lock(&tb_stats_lock);
+    tb_stats_get(tb->pc)->invalidations++;
+    qemu_mutex_unlock(&tb_stats_lock);
+}
+
+static gboolean tb_stats_flush_iter(gpointer key, gpointer value,
+                                    gpointer data)
+{
+    const TranslationBlock *tb = value;
+
+    /* Invalidated TBs were already accounted for */
+    if (!(tb_cflags(tb) & CF_INVALID)) {
+        tb_stats_get(tb->pc)->flushes++;
+    }
+    return false;
+}
+
+void tb_stats_flushed(void)
+{
+    qemu_mutex_lock(&tb_stats_lock);
+    tcg_tb_foreach(tb_stats_flush_iter, NULL);
+    qemu_mutex_unlock(&tb_stats_lock);
+}
+
+void qmp_x_tb_stats(bool enable, bool has_executions, bool executions,
+                    bool has_reset, bool reset, Error **errp)
+{
+    static bool initialized;
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "TB statistics require the TCG accelerator");
+        return;
+    }
+
+    if (!initialized) {
+        qemu_mutex_init(&tb_stats_lock);
+        tb_stats_table = g_hash_table_new(g_str_hash, g_str_equal);
+        initialized = true;
+    }
+
+    if (has_reset && reset) {
+        GHashTableIter iter;
+        TBSymbolStats *s;
+
+        qemu_mutex_lock(&tb_stats_lock);
+        g_hash_table_iter_init(&iter, tb_stats_table);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&s)) {
+            char *symbol = s->symbol;
+
+            *s = (TBSymbolStats) { .symbol = symbol };
+        }
+        tb_stats_exec_counted = tb_stats_exec_enabled;
+        qemu_mutex_unlock(&tb_stats_lock);
+    }
+
+    /* Retranslate everything with or without the counters */
+    executions = enable && has_executions && executions;
+    if (executions != tb_stats_exec_enabled) {
+        qatomic_set(&tb_stats_exec_enabled, executions);
+        tb_flush(first_cpu);
+    }
+    if (executions) {
+        tb_stats_exec_counted = true;
+    }
+    qatomic_set(&tb_stats_enabled, enable);
+}
+
+static gint tb_stats_cmp(gconstpointer a, gconstpointer b)
+{
+    const TBSymbolStats *sa = a, *sb = b;
+
+    if (sa->translate_ns != sb->translate_ns) {
+        return sa->translate_ns < sb->translate_ns ? 1 : -1;
+    }
+    return strcmp(sa->symbol, sb->symbol);
+}
+
+TbSymbolStatsList *qmp_x_query_tb_stats(Error **errp)
+{
+    TbSymbolStatsList *head = NULL, **tail = &head;
+    g_autoptr(GList) entries = NULL;
+    GList *l;
+
+    if (!tb_stats_table) {
+        return NULL;
+    }
+
+    qemu_mutex_lock(&tb_stats_lock);
+    entries = g_list_sort(g_hash_table_get_values(tb_stats_table),
+                          tb_stats_cmp);
+    for (l = entries; l; l = l->next) {
+        TBSymbolStats *s = l->data;
+        TbSymbolStats *value;
+
+        if (!s->tbs && !s->executions && !s->invalidations && !s->flushes) {
+            continue;
+        }
+        value = g_new0(TbSymbolStats, 1);
+        value->symbol = g_strdup(s->symbol);
+        value->tbs = s->tbs;
+        value->guest_bytes = s->guest_bytes;
+        value->code_bytes = s->code_bytes;
+        value->translate_ns = s->translate_ns;
+        value->has_executions = tb_stats_exec_counted;
+        value->executions = s->executions;
+        value->invalidations = s->invalidations;
+        value->flushes = s->flushes;
+        QAPI_LIST_APPEND(tail, value);
+    }
+    qemu_mutex_unlock(&tb_stats_lock);
+
+    return head;
+}
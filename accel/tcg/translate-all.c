@@ -899,11 +899,91 @@ static bool tb_cmp(const void *ap, const void *bp)
         a->page_addr[1] == b->page_addr[1];
 }
 
+static void tb_hot_init(void);
+
 void tb_htable_init(void)
 {
     unsigned int mode = QHT_MODE_AUTO_RESIZE;
 
     qht_init(&tb_ctx.htable, tb_cmp, CODE_GEN_HTABLE_SIZE, mode);
+    tb_hot_init();
+}
+
+/*
+ * Superblocks: TBs executed tb_hot_threshold times are retranslated with
+ * DisasContextBase.superblock set, which lets the target follow direct
+ * branches.  The set of hot TBs is keyed like the TB hash table but by
+ * virtual address only, and survives tb_flush().
+ */
+uint32_t tb_hot_threshold;
+
+typedef struct TBHotKey {
+    target_ulong pc;
+    target_ulong cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+} TBHotKey;
+
+static QemuMutex tb_hot_lock;
+static GHashTable *tb_hot_set;
+
+static guint tb_hot_key_hash(gconstpointer key)
+{
+    const TBHotKey *k = key;
+
+    return qemu_xxhash6(k->pc, k->cs_base, k->flags, k->cflags);
+}
+
+static gboolean tb_hot_key_equal(gconstpointer a, gconstpointer b)
+{
+    const TBHotKey *ka = a, *kb = b;
+
+    return ka->pc == kb->pc && ka->cs_base == kb->cs_base &&
+           ka->flags == kb->flags && ka->cflags == kb->cflags;
+}
+
+static void tb_hot_init(void)
+{
+    qemu_mutex_init(&tb_hot_lock);
+    tb_hot_set = g_hash_table_new_full(tb_hot_key_hash, tb_hot_key_equal,
+                                       g_free, NULL);
+}
+
+static void tb_hot_key(const TranslationBlock *tb, TBHotKey *k)
+{
+    k->pc = tb->pc;
+    k->cs_base = tb->cs_base;
+    k->flags = tb->flags;
+    k->cflags = tb_cflags(tb) & ~CF_INVALID;
+}
+
+bool tb_is_hot(const TranslationBlock *tb)
+{
+    TBHotKey k;
+    bool hot;
+
+    tb_hot_key(tb, &k);
+    qemu_mutex_lock(&tb_hot_lock);
+    hot = g_hash_table_contains(tb_hot_set, &k);
+    qemu_mutex_unlock(&tb_hot_lock);
+    return hot;
+}
+
+/*
+ * The TB goes on running to its end, but is removed from the hash table
+ * and unchained, so that it is retranslated when it is next looked up.
+ */
+void tb_mark_hot(TranslationBlock *tb)
+{
+    TBHotKey *k = g_new(TBHotKey, 1);
+
+    tb_hot_key(tb, k);
+    qemu_mutex_lock(&tb_hot_lock);
+    g_hash_table_add(tb_hot_set, k);
+    qemu_mutex_unlock(&tb_hot_lock);
+
+    trace_tb_hot(tb, tb->pc);
+    tb_phys_invalidate(tb, -1);
 }
 
 /* call with @p->lock held */
@@ -984,6 +1064,12 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
                tcg_code_size(), nb_tbs, nb_tbs > 0 ? host_size / nb_tbs : 0);
     }
 
+#ifdef CONFIG_SOFTMMU
+    if (qatomic_read(&tb_stats_enabled)) {
+        tb_stats_flushed();
+    }
+#endif
+
     CPU_FOREACH(cpu) {
         cpu_tb_jmp_cache_clear(cpu);
     }
@@ -1191,6 +1277,11 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     if (!qht_remove(&tb_ctx.htable, tb, h)) {
         return;
     }
+#ifdef CONFIG_SOFTMMU
+    if (qatomic_read(&tb_stats_enabled)) {
+        tb_stats_invalidated(tb);
+    }
+#endif
 
     /* remove the TB from the page list */
     if (rm_from_page_list) {
@@ -1392,6 +1483,9 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     TCGProfile *prof = &tcg_ctx->prof;
     int64_t ti;
 #endif
+#ifdef CONFIG_SOFTMMU
+    int64_t stats_start = qatomic_read(&tb_stats_enabled) ? get_clock() : 0;
+#endif
 
     assert_memory_lock();
     qemu_thread_jit_write();
@@ -1427,6 +1521,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->flags = flags;
     tb->cflags = cflags;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    tb->exec_count = 0;
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
 
@@ -1657,6 +1752,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         tcg_tb_remove(tb);
         return existing_tb;
     }
+#ifdef CONFIG_SOFTMMU
+    if (stats_start) {
+        tb_stats_translated(tb, get_clock() - stats_start);
+    }
+#endif
     return tb;
 }
 
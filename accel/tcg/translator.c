@@ -17,6 +17,7 @@
 #include "exec/translator.h"
 #include "exec/plugin-gen.h"
 #include "sysemu/replay.h"
+#include "internal.h"
 
 /* Pairs with tcg_clear_temp_count.
    To be called by #TranslatorOps.{translate_insn,tb_stop} if
@@ -42,6 +43,47 @@ bool translator_use_goto_tb(DisasContextBase *db, target_ulong dest)
     return ((db->pc_first ^ dest) & TARGET_PAGE_MASK) == 0;
 }
 
+/*
+ * Count the executions of the TB, and have it retranslated as a
+ * superblock when it becomes hot.
+ */
+static void gen_tb_exec_count(TranslationBlock *tb)
+{
+    TCGv_ptr ptr = tcg_constant_ptr(&tb->exec_count);
+    TCGv_i32 count = tcg_temp_new_i32();
+    TCGLabel *cold = gen_new_label();
+
+    tcg_gen_ld_i32(count, ptr, 0);
+    tcg_gen_addi_i32(count, count, 1);
+    tcg_gen_st_i32(count, ptr, 0);
+    tcg_gen_brcondi_i32(TCG_COND_NE, count, tb_hot_threshold, cold);
+    gen_helper_tb_hot(tcg_constant_ptr(tb));
+    gen_set_label(cold);
+    tcg_temp_free_i32(count);
+}
+
+/*
+ * Blocks that are never extended nor counted.  A superblock charges all
+ * its instructions to icount on entry, but its side exits skip some of
+ * them, so icount would run ahead of the guest.
+ */
+#define CF_NO_SUPERBLOCK \
+    (CF_COUNT_MASK | CF_LAST_IO | CF_NOIRQ | CF_SINGLE_STEP | CF_USE_ICOUNT)
+
+#ifdef CONFIG_SOFTMMU
+/* Count the entries into the TB in the statistics of its function */
+static void gen_tb_stats_exec(TranslationBlock *tb)
+{
+    TCGv_ptr ptr = tcg_constant_ptr(tb_stats_exec_counter(tb->pc));
+    TCGv_i64 count = tcg_temp_new_i64();
+
+    tcg_gen_ld_i64(count, ptr, 0);
+    tcg_gen_addi_i64(count, count, 1);
+    tcg_gen_st_i64(count, ptr, 0);
+    tcg_temp_free_i64(count);
+}
+#endif
+
 static inline void translator_page_protect(DisasContextBase *dcbase,
                                            target_ulong pc)
 {
@@ -65,6 +107,11 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     db->num_insns = 0;
     db->max_insns = max_insns;
     db->singlestep_enabled = cflags & CF_SINGLE_STEP;
+    db->superblock = false;
+    db->pc_max = db->pc_first;
+    if (tb_hot_threshold && !(cflags & CF_NO_SUPERBLOCK)) {
+        db->superblock = tb_is_hot(tb);
+    }
     translator_page_protect(db, db->pc_next);
 
     ops->init_disas_context(db, cpu);
@@ -75,6 +122,15 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 
     /* Start translating.  */
     gen_tb_start(db->tb);
+    if (tb_hot_threshold && !db->superblock &&
+        !(cflags & CF_NO_SUPERBLOCK)) {
+        gen_tb_exec_count(tb);
+    }
+#ifdef CONFIG_SOFTMMU
+    if (qatomic_read(&tb_stats_exec_enabled)) {
+        gen_tb_stats_exec(tb);
+    }
+#endif
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
@@ -133,7 +189,7 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     }
 
     /* The disas_log hook may use these values rather than recompute.  */
-    tb->size = db->pc_next - db->pc_first;
+    tb->size = MAX(db->pc_next, db->pc_max) - db->pc_first;
     tb->icount = db->num_insns;
 
 #ifdef DEBUG_DISAS
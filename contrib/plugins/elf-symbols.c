@@ -0,0 +1,128 @@
+/*
+ * Function symbols of a firmware ELF
+ *
+ * Only the section headers and the symbol tables of 32-bit little-endian
+ * images are parsed.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "elf-symbols.h"
+
+typedef struct {
+    uint8_t e_ident[16];
+    uint16_t e_type, e_machine;
+    uint32_t e_version, e_entry, e_phoff, e_shoff, e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+} Elf32Ehdr;
+
+typedef struct {
+    uint32_t sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size;
+    uint32_t sh_link, sh_info, sh_addralign, sh_entsize;
+} Elf32Shdr;
+
+typedef struct {
+    uint32_t st_name, st_value, st_size;
+    uint8_t st_info, st_other;
+    uint16_t st_shndx;
+} Elf32Sym;
+
+#define SHT_SYMTAB  2
+#define STT_FUNC    2
+
+static gint cmp_function(gconstpointer a, gconstpointer b)
+{
+    const ElfFunction *fa = a, *fb = b;
+
+    return fa->addr < fb->addr ? -1 : fa->addr > fb->addr;
+}
+
+bool elf_load_functions(GArray *funcs, const char *path, const char *plugin)
+{
+    g_autoptr(GError) err = NULL;
+    const Elf32Ehdr *eh;
+    const Elf32Shdr *shdrs;
+    gchar *data;
+    gsize len;
+    int i, shnum;
+
+    if (!g_file_get_contents(path, &data, &len, &err)) {
+        fprintf(stderr, "%s: %s\n", plugin, err->message);
+        return false;
+    }
+    eh = (const Elf32Ehdr *)data;
+    if (len < sizeof(*eh) || memcmp(eh->e_ident, "\177ELF", 4) ||
+        eh->e_ident[4] != 1 || eh->e_ident[5] != 1 ||
+        GUINT32_FROM_LE(eh->e_shoff) +
+        (uint64_t)GUINT16_FROM_LE(eh->e_shnum) * sizeof(Elf32Shdr) > len) {
+        fprintf(stderr, "%s: %s is not a 32-bit little-endian ELF\n",
+                plugin, path);
+        g_free(data);
+        return false;
+    }
+    shdrs = (const Elf32Shdr *)(data + GUINT32_FROM_LE(eh->e_shoff));
+    shnum = GUINT16_FROM_LE(eh->e_shnum);
+
+    /* the names point into the image, which is kept until exit */
+    for (i = 0; i < shnum; i++) {
+        const Elf32Shdr *strsh;
+        uint32_t off = GUINT32_FROM_LE(shdrs[i].sh_offset);
+        uint32_t size = GUINT32_FROM_LE(shdrs[i].sh_size);
+        uint32_t j;
+
+        if (GUINT32_FROM_LE(shdrs[i].sh_type) != SHT_SYMTAB ||
+            GUINT32_FROM_LE(shdrs[i].sh_link) >= shnum ||
+            (uint64_t)off + size > len) {
+            continue;
+        }
+        strsh = &shdrs[GUINT32_FROM_LE(shdrs[i].sh_link)];
+        for (j = 0; j + sizeof(Elf32Sym) <= size; j += sizeof(Elf32Sym)) {
+            const Elf32Sym *st = (const Elf32Sym *)(data + off + j);
+            uint32_t name = GUINT32_FROM_LE(st->st_name);
+            ElfFunction f;
+
+            if ((st->st_info & 0xf) != STT_FUNC ||
+                name >= GUINT32_FROM_LE(strsh->sh_size) ||
+                GUINT32_FROM_LE(strsh->sh_offset) + (uint64_t)name >= len) {
+                continue;
+            }
+            /* clear the Thumb bit */
+            f.addr = GUINT32_FROM_LE(st->st_value) & ~1u;
+            f.size = GUINT32_FROM_LE(st->st_size);
+            f.name = data + GUINT32_FROM_LE(strsh->sh_offset) + name;
+            g_array_append_val(funcs, f);
+        }
+    }
+    g_array_sort(funcs, cmp_function);
+    return true;
+}
+
+int elf_find_function(GArray *funcs, uint64_t addr)
+{
+    int lo = 0, hi = (int)funcs->len - 1;
+    int best = -1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+
+        if (g_array_index(funcs, ElfFunction, mid).addr <= addr) {
+            best = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (best >= 0) {
+        const ElfFunction *f = &g_array_index(funcs, ElfFunction, best);
+
+        if (f->size && addr >= f->addr + f->size) {
+            return -1;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,32 @@
+/*
+ * Function symbols of a firmware ELF, shared by the plugins that need
+ * to name the guest code
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#ifndef PLUGINS_ELF_SYMBOLS_H
+#define PLUGINS_ELF_SYMBOLS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+typedef struct {
+    uint64_t addr;      /* with the Thumb bit cleared */
+    uint64_t size;
+    const char *name;
+} ElfFunction;
+
+/*
+ * Append the STT_FUNC symbols of the 32-bit little-endian ELF at @path
+ * to @funcs, an array of ElfFunction, and sort it by address.  The names
+ * point into the image, which is kept until exit.  Errors are reported
+ * on stderr, prefixed with @plugin.
+ */
+bool elf_load_functions(GArray *funcs, const char *path, const char *plugin);
+
+/* Index of the function of @funcs containing @addr, or -1 */
+int elf_find_function(GArray *funcs, uint64_t addr);
+
+#endif
@@ -0,0 +1,558 @@
+/*
+ * Memory timing model for the STM32 of the NumWorks calculators
+ *
+ * Estimates the cycles a firmware would take on the real device from
+ * the instructions it executes and the memory they access. Each access
+ * is charged according to the memory it targets: TCMs are free, flash
+ * costs its wait states unless it hits in the ART accelerator or the
+ * L1 caches, external QSPI flash costs a full line fill on a miss, and
+ * peripherals cost a bus access. The estimate is broken down by memory,
+ * by function (with the symbols of the firmware ELF) and by frame.
+ *
+ * The latencies are estimates from the reference manuals, not
+ * measurements, and every instruction otherwise costs "cpi" cycles.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "elf-symbols.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* Caches */
+
+typedef struct {
+    const char *name;
+    int size;
+    int assoc;
+    int line_bits;
+    /* tag of each block, UINT64_MAX when invalid, and its last use */
+    uint64_t *tags;
+    uint64_t *stamps;
+    uint64_t clock;
+    int num_sets;
+    uint64_t accesses;
+    uint64_t misses;
+} Cache;
+
+enum {
+    CACHE_L1I,
+    CACHE_L1D,
+    CACHE_ARTI,
+    CACHE_ARTD,
+    CACHE_QSPI,
+    CACHE_NONE = -1,
+};
+
+#define N_CACHES 5
+
+static Cache caches[N_CACHES];
+
+static void cache_init(Cache *c, const char *name, int size, int assoc,
+                       int line_bits)
+{
+    int i;
+
+    c->name = name;
+    c->size = size;
+    c->assoc = assoc;
+    c->line_bits = line_bits;
+    c->num_sets = size ? (size >> line_bits) / assoc : 0;
+    c->tags = g_new(uint64_t, c->num_sets * assoc);
+    c->stamps = g_new0(uint64_t, c->num_sets * assoc);
+    for (i = 0; i < c->num_sets * assoc; i++) {
+        c->tags[i] = UINT64_MAX;
+    }
+}
+
+/* Returns true on a hit; a miss allocates the line if @allocate */
+static bool cache_access(Cache *c, uint64_t addr, bool allocate)
+{
+    uint64_t line = addr >> c->line_bits;
+    int set = line % c->num_sets;
+    uint64_t *tags = c->tags + set * c->assoc;
+    uint64_t *stamps = c->stamps + set * c->assoc;
+    int i, victim = 0;
+
+    c->accesses++;
+    c->clock++;
+    for (i = 0; i < c->assoc; i++) {
+        if (tags[i] == line) {
+            stamps[i] = c->clock;
+            return true;
+        }
+        if (stamps[i] < stamps[victim]) {
+            victim = i;
+        }
+    }
+    c->misses++;
+    if (allocate) {
+        tags[victim] = line;
+        stamps[victim] = c->clock;
+    }
+    return false;
+}
+
+/* Memories */
+
+typedef struct {
+    const char *name;
+    uint64_t base;
+    uint64_t size;
+    /* cycles to fill a line or to do an uncached access */
+    int latency;
+    int icache;
+    int dcache;
+    /* peripherals and strongly-ordered memory stall on stores too */
+    bool device;
+    uint64_t fetches;
+    uint64_t fetch_stalls;
+    uint64_t accesses;
+    uint64_t data_stalls;
+} Memory;
+
+typedef struct {
+    const char *name;
+    int mhz;
+    bool l1;
+    int art_line_bits;
+    int art_ilines;
+    int art_dlines;
+    Memory *mems;
+} Board;
+
+/*
+ * STM32F730 at 216 MHz: flash with 7 wait states, read through the ART
+ * on the ITCM interface and through the L1 caches on the AXIM interface.
+ * SRAM1/2 and the QSPI flash are behind the L1 caches too.
+ */
+static Memory n0110_mems[] = {
+    { "itcm-ram",   0x00000000, 0x00004000,   0, CACHE_NONE, CACHE_NONE },
+    { "flash-itcm", 0x00200000, 0x00010000,   7, CACHE_ARTI, CACHE_ARTD },
+    { "flash-axim", 0x08000000, 0x00010000,  10, CACHE_L1I,  CACHE_L1D },
+    { "dtcm",       0x20000000, 0x00010000,   0, CACHE_NONE, CACHE_NONE },
+    { "sram",       0x20010000, 0x00030000,   6, CACHE_L1I,  CACHE_L1D },
+    { "peripheral", 0x40000000, 0x20000000,   4, CACHE_NONE, CACHE_NONE,
+      true },
+    { "fmc",        0x60000000, 0x10000000,  12, CACHE_NONE, CACHE_NONE,
+      true },
+    { "qspi",       0x90000000, 0x10000000,  96, CACHE_L1I,  CACHE_L1D },
+    { "system",     0xe0000000, 0x20000000,   1, CACHE_NONE, CACHE_NONE,
+      true },
+    { NULL }
+};
+
+/*
+ * STM32F412 at 100 MHz: no L1 cache, flash with 3 wait states behind
+ * the ART, and the QSPI flash behind a single line prefetch buffer.
+ */
+static Memory n0100_mems[] = {
+    { "flash-alias", 0x00000000, 0x00100000,   3, CACHE_ARTI, CACHE_ARTD },
+    { "flash",       0x08000000, 0x00100000,   3, CACHE_ARTI, CACHE_ARTD },
+    { "sram",        0x20000000, 0x00040000,   0, CACHE_NONE, CACHE_NONE },
+    { "peripheral",  0x40000000, 0x20000000,   2, CACHE_NONE, CACHE_NONE,
+      true },
+    { "fsmc",        0x60000000, 0x10000000,   8, CACHE_NONE, CACHE_NONE,
+      true },
+    { "qspi",        0x90000000, 0x10000000,  48, CACHE_QSPI, CACHE_QSPI },
+    { "system",      0xe0000000, 0x20000000,   1, CACHE_NONE, CACHE_NONE,
+      true },
+    { NULL }
+};
+
+static Board boards[] = {
+    { "n0110", 216, true,  5, 64, 0, n0110_mems },
+    { "n0100", 100, false, 4, 64, 8, n0100_mems },
+};
+
+static Board *board;
+static int mhz;
+static double cpi = 1.0;
+
+static Memory other_mem = { "other", 0, 0, 1, CACHE_NONE, CACHE_NONE };
+
+static Memory *find_memory(uint64_t addr)
+{
+    Memory *m;
+
+    for (m = board->mems; m->name; m++) {
+        if (addr - m->base < m->size) {
+            return m;
+        }
+    }
+    return &other_mem;
+}
+
+/* Charge an access, returns the stall cycles */
+static uint64_t access_memory(Memory *m, uint64_t addr, bool fetch,
+                              bool store)
+{
+    int c = fetch ? m->icache : m->dcache;
+
+    if (c == CACHE_NONE || !caches[c].num_sets) {
+        return store && !m->device ? 0 : m->latency;
+    }
+    if (cache_access(&caches[c], addr, !store)) {
+        return 0;
+    }
+    /* store misses go to the write buffer */
+    return store ? 1 : m->latency;
+}
+
+/* Functions of the firmware, indexed like the ElfFunction symbols */
+
+typedef struct {
+    uint64_t addr;
+    const char *name;
+    uint64_t insns;
+    uint64_t cycles;
+    uint64_t stalls;
+} Function;
+
+static GArray *symbols;
+static GArray *functions;
+static Function unknown_function = { .name = "[unknown]" };
+
+static Function *find_function(uint64_t addr)
+{
+    int i = elf_find_function(symbols, addr);
+
+    return i < 0 ? &unknown_function : &g_array_index(functions, Function, i);
+}
+
+/* Execution */
+
+typedef struct {
+    uint64_t pc;
+    Memory *mem;
+    Function *func;
+    int n_insns;
+    uint64_t *insn_addrs;
+} TBInfo;
+
+static GMutex lock;
+static GPtrArray *tb_infos;
+
+static Function *cur_func = &unknown_function;
+static uint64_t insns, cycles;
+
+static const char *frame_arg;
+static uint64_t frame_pc = UINT64_MAX;
+static uint64_t frame_start = UINT64_MAX;
+static GArray *frame_cycles;
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    TBInfo *tb = udata;
+    Memory *m = tb->mem;
+    uint64_t line = UINT64_MAX, stalls = 0, tb_cycles;
+    int line_bits = 2;
+    int c = m->icache;
+    int i;
+
+    if (cpu_index) {
+        return;
+    }
+    if (tb->pc == frame_pc) {
+        if (frame_start != UINT64_MAX) {
+            uint64_t len = cycles - frame_start;
+            g_array_append_val(frame_cycles, len);
+        }
+        frame_start = cycles;
+    }
+
+    /* fetches are charged once per line, uncached ones once per word */
+    if (c != CACHE_NONE && caches[c].num_sets) {
+        line_bits = caches[c].line_bits;
+    }
+    for (i = 0; i < tb->n_insns; i++) {
+        if (tb->insn_addrs[i] >> line_bits != line) {
+            line = tb->insn_addrs[i] >> line_bits;
+            m->fetches++;
+            stalls += access_memory(m, tb->insn_addrs[i], true, false);
+        }
+    }
+    m->fetch_stalls += stalls;
+
+    tb_cycles = tb->n_insns * cpi + 0.5 + stalls;
+    cur_func = tb->func;
+    cur_func->insns += tb->n_insns;
+    cur_func->cycles += tb_cycles;
+    cur_func->stalls += stalls;
+    insns += tb->n_insns;
+    cycles += tb_cycles;
+}
+
+static void vcpu_mem_access(unsigned int cpu_index, qemu_plugin_meminfo_t info,
+                            uint64_t vaddr, void *udata)
+{
+    Memory *m;
+    uint64_t stalls;
+
+    if (cpu_index) {
+        return;
+    }
+    m = find_memory(vaddr);
+    stalls = access_memory(m, vaddr, false, qemu_plugin_mem_is_store(info));
+    m->accesses++;
+    m->data_stalls += stalls;
+    cur_func->cycles += stalls;
+    cur_func->stalls += stalls;
+    cycles += stalls;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    TBInfo *info = g_new0(TBInfo, 1);
+    int i;
+
+    info->pc = qemu_plugin_tb_vaddr(tb);
+    info->mem = find_memory(info->pc);
+    info->func = find_function(info->pc);
+    info->n_insns = qemu_plugin_tb_n_insns(tb);
+    info->insn_addrs = g_new(uint64_t, info->n_insns);
+
+    for (i = 0; i < info->n_insns; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+
+        info->insn_addrs[i] = qemu_plugin_insn_vaddr(insn);
+        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem_access,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, NULL);
+    }
+
+    g_mutex_lock(&lock);
+    /* kept until exit, as the TB may be executed until then */
+    g_ptr_array_add(tb_infos, info);
+    g_mutex_unlock(&lock);
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS, info);
+}
+
+/* Report */
+
+static int limit = 20;
+
+static gint cmp_cycles(gconstpointer a, gconstpointer b)
+{
+    const Function *fa = *(Function **)a, *fb = *(Function **)b;
+
+    return fa->cycles > fb->cycles ? -1 : fa->cycles < fb->cycles;
+}
+
+static double cycles_to_ms(uint64_t c)
+{
+    return c / (mhz * 1000.0);
+}
+
+static void report_frames(GString *report)
+{
+    uint64_t min = UINT64_MAX, max = 0, total = 0;
+    int i;
+
+    if (!frame_cycles->len) {
+        g_string_append_printf(report, "\nno complete frame at %s\n",
+                               frame_arg);
+        return;
+    }
+    for (i = 0; i < frame_cycles->len; i++) {
+        uint64_t c = g_array_index(frame_cycles, uint64_t, i);
+
+        min = MIN(min, c);
+        max = MAX(max, c);
+        total += c;
+    }
+    g_string_append_printf(report,
+                           "\nframes, min cycles, avg cycles, max cycles\n"
+                           "%u, %" PRIu64 " (%.3f ms), %" PRIu64
+                           " (%.3f ms), %" PRIu64 " (%.3f ms)\n",
+                           frame_cycles->len,
+                           min, cycles_to_ms(min),
+                           total / frame_cycles->len,
+                           cycles_to_ms(total / frame_cycles->len),
+                           max, cycles_to_ms(max));
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new(NULL);
+    g_autoptr(GPtrArray) funcs = g_ptr_array_new();
+    Memory *m;
+    int i;
+
+    g_string_append_printf(report,
+                           "board %s at %d MHz: %" PRIu64 " insns, %" PRIu64
+                           " cycles (%.3f ms)\n",
+                           board->name, mhz, insns, cycles,
+                           cycles_to_ms(cycles));
+
+    g_string_append(report, "\nmemory, fetches, fetch stalls, "
+                    "data accesses, data stalls\n");
+    for (m = board->mems; ; m++) {
+        if (!m->name) {
+            m = &other_mem;
+        }
+        if (m->fetches || m->accesses) {
+            g_string_append_printf(report, "%s, %" PRIu64 ", %" PRIu64
+                                   ", %" PRIu64 ", %" PRIu64 "\n",
+                                   m->name, m->fetches, m->fetch_stalls,
+                                   m->accesses, m->data_stalls);
+        }
+        if (m == &other_mem) {
+            break;
+        }
+    }
+
+    g_string_append(report, "\ncache, accesses, misses, miss rate\n");
+    for (i = 0; i < N_CACHES; i++) {
+        Cache *c = &caches[i];
+
+        if (c->accesses) {
+            g_string_append_printf(report, "%s, %" PRIu64 ", %" PRIu64
+                                   ", %.2f%%\n", c->name, c->accesses,
+                                   c->misses, 100.0 * c->misses / c->accesses);
+        }
+    }
+
+    for (i = 0; i < functions->len; i++) {
+        Function *f = &g_array_index(functions, Function, i);
+
+        if (f->cycles) {
+            g_ptr_array_add(funcs, f);
+        }
+    }
+    if (unknown_function.cycles) {
+        g_ptr_array_add(funcs, &unknown_function);
+    }
+    g_ptr_array_sort(funcs, cmp_cycles);
+    g_string_append(report, "\nfunction, insns, cycles, stall cycles\n");
+    for (i = 0; i < funcs->len && i < limit; i++) {
+        Function *f = g_ptr_array_index(funcs, i);
+
+        g_string_append_printf(report, "%s, %" PRIu64 ", %" PRIu64
+                               ", %" PRIu64 "\n",
+                               f->name, f->insns, f->cycles, f->stalls);
+    }
+
+    if (frame_arg) {
+        report_frames(report);
+    }
+    qemu_plugin_outs(report->str);
+}
+
+static bool setup_frame(void)
+{
+    char *end;
+    int i;
+
+    frame_pc = g_ascii_strtoull(frame_arg, &end, 0);
+    if (*frame_arg && !*end) {
+        return true;
+    }
+    for (i = 0; i < functions->len; i++) {
+        Function *f = &g_array_index(functions, Function, i);
+
+        if (!strcmp(f->name, frame_arg)) {
+            frame_pc = f->addr;
+            return true;
+        }
+    }
+    fprintf(stderr, "memtiming: unknown frame function %s\n", frame_arg);
+    return false;
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int icache = 8 * 1024, dcache = 8 * 1024;
+    int i;
+
+    board = &boards[0];
+    symbols = g_array_new(false, false, sizeof(ElfFunction));
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_autofree char **tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "board") == 0) {
+            int j;
+
+            board = NULL;
+            for (j = 0; j < G_N_ELEMENTS(boards); j++) {
+                if (g_strcmp0(tokens[1], boards[j].name) == 0) {
+                    board = &boards[j];
+                }
+            }
+            if (!board) {
+                fprintf(stderr, "memtiming: unknown board %s\n", tokens[1]);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "elf") == 0) {
+            if (!elf_load_functions(symbols, tokens[1], "memtiming")) {
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "frame") == 0) {
+            frame_arg = g_strdup(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "mhz") == 0) {
+            mhz = g_ascii_strtoll(tokens[1], NULL, 10);
+        } else if (g_strcmp0(tokens[0], "cpi") == 0) {
+            cpi = g_ascii_strtod(tokens[1], NULL);
+        } else if (g_strcmp0(tokens[0], "icachesize") == 0) {
+            icache = g_ascii_strtoll(tokens[1], NULL, 10);
+        } else if (g_strcmp0(tokens[0], "dcachesize") == 0) {
+            dcache = g_ascii_strtoll(tokens[1], NULL, 10);
+        } else if (g_strcmp0(tokens[0], "limit") == 0) {
+            limit = g_ascii_strtoll(tokens[1], NULL, 10);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+    functions = g_array_sized_new(false, false, sizeof(Function), symbols->len);
+    for (i = 0; i < symbols->len; i++) {
+        const ElfFunction *s = &g_array_index(symbols, ElfFunction, i);
+        Function f = { .addr = s->addr, .name = s->name };
+
+        g_array_append_val(functions, f);
+    }
+    if (frame_arg && !setup_frame()) {
+        return -1;
+    }
+    if (!mhz) {
+        mhz = board->mhz;
+    }
+    if (!board->l1) {
+        icache = dcache = 0;
+    }
+    if (icache % (2 * 32) || dcache % (4 * 32) || cpi < 0 || mhz <= 0) {
+        fprintf(stderr, "memtiming: invalid cache size, cpi or frequency\n");
+        return -1;
+    }
+
+    /* Cortex-M7 L1: 2-way I-cache and 4-way D-cache, 32-byte lines */
+    cache_init(&caches[CACHE_L1I], "l1i", icache, 2, 5);
+    cache_init(&caches[CACHE_L1D], "l1d", dcache, 4, 5);
+    cache_init(&caches[CACHE_ARTI], "art-i",
+               board->art_ilines << board->art_line_bits,
+               board->art_ilines, board->art_line_bits);
+    cache_init(&caches[CACHE_ARTD], "art-d",
+               board->art_dlines << board->art_line_bits,
+               MAX(board->art_dlines, 1), board->art_line_bits);
+    cache_init(&caches[CACHE_QSPI], "qspi-prefetch", board->l1 ? 0 : 32, 1, 5);
+
+    frame_cycles = g_array_new(false, false, sizeof(uint64_t));
+    tb_infos = g_ptr_array_new();
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * Sampling profiler for Cortex-M firmware
+ *
+ * Every N instructions, the call stack of the vCPU is recorded and
+ * symbolised with the symbol table of the firmware ELF. The samples
+ * are reported as folded stacks, one "frame;frame;...;leaf count" line
+ * per distinct stack, which flamegraph tools accept directly.
+ *
+ * The call stack is a shadow stack maintained at TB granularity: a TB
+ * ending with a Thumb BL or BLX pushes a frame for the next TB, which
+ * is popped once execution reaches its return address. Exception
+ * entries are recognised from the EXC_RETURN value in LR when a TB
+ * starts a function, and popped once execution returns to the PC
+ * stacked by the exception entry.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "elf-symbols.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define MAX_DEPTH 128
+
+/* Symbol table, of ElfFunction */
+static GArray *symbols;
+
+/* A function started by a call or an exception */
+typedef struct {
+    uint64_t entry;
+    uint64_t ret;
+    bool exception;
+} Frame;
+
+typedef struct {
+    Frame frames[MAX_DEPTH];
+    int depth;
+    /* return address of the call ending the previous TB, or 0 */
+    uint64_t call_ret;
+    uint64_t insns;
+    uint64_t next_sample;
+} VCPUState;
+
+typedef struct {
+    uint64_t pc;
+    unsigned n_insns;
+    uint64_t call_ret;
+    bool func_entry;
+} TBInfo;
+
+static GMutex lock;
+static GHashTable *tbs;
+static GPtrArray *stale_tbs;
+static GHashTable *stacks;
+static VCPUState *vcpus;
+static int n_vcpus;
+
+static uint64_t period = 10000;
+static char *outfile;
+
+static struct qemu_plugin_register *reg_sp, *reg_lr;
+static bool regs_found;
+
+static const ElfFunction *find_symbol(uint64_t addr)
+{
+    int i = elf_find_function(symbols, addr);
+
+    return i < 0 ? NULL : &g_array_index(symbols, ElfFunction, i);
+}
+
+static void append_frame(GString *s, uint64_t addr)
+{
+    const ElfFunction *sym = find_symbol(addr);
+
+    if (s->len) {
+        g_string_append_c(s, ';');
+    }
+    if (sym) {
+        g_string_append(s, sym->name);
+    } else {
+        g_string_append_printf(s, "0x%08" PRIx64, addr);
+    }
+}
+
+/* Registers */
+
+static void find_registers(void)
+{
+    g_autofree qemu_plugin_reg_descriptor *regs = NULL;
+    int n, i;
+
+    n = qemu_plugin_get_registers(NULL, 0);
+    regs = g_new0(qemu_plugin_reg_descriptor, n);
+    qemu_plugin_get_registers(regs, n);
+    for (i = 0; i < n; i++) {
+        if (!strcmp(regs[i].name, "sp")) {
+            reg_sp = regs[i].handle;
+        } else if (!strcmp(regs[i].name, "lr")) {
+            reg_lr = regs[i].handle;
+        }
+    }
+    if (!reg_sp || !reg_lr) {
+        fprintf(stderr, "stackprof: no sp and lr registers, "
+                "exceptions will not be unwound\n");
+    }
+}
+
+static bool read_reg32(struct qemu_plugin_register *reg, uint32_t *val)
+{
+    uint32_t buf;
+
+    if (!reg || qemu_plugin_read_register(reg, &buf, sizeof(buf)) != 4) {
+        return false;
+    }
+    *val = GUINT32_FROM_LE(buf);
+    return true;
+}
+
+/* Shadow stack */
+
+static void push_frame(VCPUState *vcpu, uint64_t entry, uint64_t ret,
+                       bool exception)
+{
+    Frame *f;
+
+    if (vcpu->depth == MAX_DEPTH) {
+        /* most likely a missed return: forget the oldest frame */
+        memmove(vcpu->frames, vcpu->frames + 1,
+                (MAX_DEPTH - 1) * sizeof(Frame));
+        vcpu->depth--;
+    }
+    f = &vcpu->frames[vcpu->depth++];
+    f->entry = entry;
+    f->ret = ret;
+    f->exception = exception;
+}
+
+/*
+ * A function entered with an EXC_RETURN value in LR is an exception
+ * handler. The PC to return to is in the frame stacked on the main
+ * stack; exceptions taken from the process stack are not tracked, as
+ * the process stack pointer is not visible here.
+ */
+static bool check_exception_entry(VCPUState *vcpu, uint64_t pc)
+{
+    uint32_t lr, sp, ret;
+    Frame *top = vcpu->depth ? &vcpu->frames[vcpu->depth - 1] : NULL;
+
+    if (!read_reg32(reg_lr, &lr) || (lr & 0xff000000) != 0xff000000) {
+        return false;
+    }
+    if ((lr & 4) || !read_reg32(reg_sp, &sp) ||
+        !qemu_plugin_read_memory_vaddr(sp + 24, &ret, sizeof(ret))) {
+        return true;
+    }
+    ret = GUINT32_FROM_LE(ret) & ~1u;
+    if (top && top->exception && top->ret == ret) {
+        /* tail-chaining: the previous handler did not return to ret */
+        top->entry = pc;
+    } else {
+        push_frame(vcpu, pc, ret, true);
+    }
+    return true;
+}
+
+static void take_sample(VCPUState *vcpu, uint64_t pc)
+{
+    g_autoptr(GString) s = g_string_new(NULL);
+    const ElfFunction *leaf = find_symbol(pc);
+    uint64_t *count;
+    int i;
+
+    for (i = 0; i < vcpu->depth; i++) {
+        append_frame(s, vcpu->frames[i].entry);
+    }
+    /* the leaf may have been entered by a tail call */
+    if (!vcpu->depth || !leaf ||
+        leaf != find_symbol(vcpu->frames[vcpu->depth - 1].entry)) {
+        append_frame(s, pc);
+    }
+
+    g_mutex_lock(&lock);
+    count = g_hash_table_lookup(stacks, s->str);
+    if (!count) {
+        count = g_new0(uint64_t, 1);
+        g_hash_table_insert(stacks, g_strdup(s->str), count);
+    }
+    (*count)++;
+    g_mutex_unlock(&lock);
+}
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    TBInfo *tb = udata;
+    VCPUState *vcpu;
+    uint64_t call_ret;
+
+    if (cpu_index >= n_vcpus) {
+        return;
+    }
+    vcpu = &vcpus[cpu_index];
+    call_ret = vcpu->call_ret;
+    vcpu->call_ret = 0;
+
+    if (vcpu->depth && vcpu->frames[vcpu->depth - 1].ret == tb->pc) {
+        vcpu->depth--;
+    } else if (tb->func_entry && check_exception_entry(vcpu, tb->pc)) {
+        /* an exception taken before the called function started */
+    } else if (call_ret && call_ret != tb->pc) {
+        push_frame(vcpu, tb->pc, call_ret, false);
+    }
+    vcpu->call_ret = tb->call_ret;
+
+    vcpu->insns += tb->n_insns;
+    if (vcpu->insns >= vcpu->next_sample) {
+        take_sample(vcpu, tb->pc);
+        vcpu->next_sample = vcpu->insns + period;
+    }
+}
+
+/* Return address of a Thumb BL or BLX, or 0 */
+static uint64_t call_return(struct qemu_plugin_insn *insn)
+{
+    const uint8_t *p = qemu_plugin_insn_data(insn);
+    size_t size = qemu_plugin_insn_size(insn);
+    uint16_t hw1 = p[0] | p[1] << 8;
+    uint16_t hw2;
+
+    if (size == 2 && (hw1 & 0xff87) == 0x4780) {
+        /* BLX <Rm> */
+        return qemu_plugin_insn_vaddr(insn) + 2;
+    }
+    if (size == 4) {
+        hw2 = p[2] | p[3] << 8;
+        if ((hw1 & 0xf800) == 0xf000 && (hw2 & 0xd000) == 0xd000) {
+            /* BL <label> */
+            return qemu_plugin_insn_vaddr(insn) + 4;
+        }
+    }
+    return 0;
+}
+
+/* Field by field, as the padding of TBInfo is undefined */
+static bool tb_info_equal(const TBInfo *a, const TBInfo *b)
+{
+    return a->pc == b->pc && a->n_insns == b->n_insns &&
+           a->call_ret == b->call_ret && a->func_entry == b->func_entry;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    const ElfFunction *sym;
+    TBInfo *info;
+    TBInfo tmp = { 0 };
+
+    tmp.pc = qemu_plugin_tb_vaddr(tb);
+    tmp.n_insns = n;
+    tmp.call_ret = call_return(qemu_plugin_tb_get_insn(tb, n - 1));
+    sym = find_symbol(tmp.pc);
+    tmp.func_entry = sym && sym->addr == tmp.pc;
+
+    g_mutex_lock(&lock);
+    if (!regs_found) {
+        find_registers();
+        regs_found = true;
+    }
+    info = g_hash_table_lookup(tbs, &tmp.pc);
+    if (!info || !tb_info_equal(info, &tmp)) {
+        if (info) {
+            /* still used by the TBs previously translated at that pc */
+            g_ptr_array_add(stale_tbs, info);
+            g_hash_table_steal(tbs, &tmp.pc);
+        }
+        info = g_new(TBInfo, 1);
+        *info = tmp;
+        g_hash_table_insert(tbs, &info->pc, info);
+    }
+    g_mutex_unlock(&lock);
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_R_REGS, info);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new(NULL);
+    GHashTableIter iter;
+    gpointer key, value;
+    FILE *f;
+
+    g_mutex_lock(&lock);
+    g_hash_table_iter_init(&iter, stacks);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        g_string_append_printf(report, "%s %" PRIu64 "\n",
+                               (char *)key, *(uint64_t *)value);
+    }
+    g_mutex_unlock(&lock);
+
+    if (!outfile) {
+        qemu_plugin_outs(report->str);
+        return;
+    }
+    f = fopen(outfile, "w");
+    if (!f) {
+        fprintf(stderr, "stackprof: cannot open %s\n", outfile);
+        return;
+    }
+    fputs(report->str, f);
+    fclose(f);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int i;
+
+    symbols = g_array_new(false, false, sizeof(ElfFunction));
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_autofree char **tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "elf") == 0) {
+            if (!elf_load_functions(symbols, tokens[1], "stackprof")) {
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "period") == 0) {
+            period = g_ascii_strtoull(tokens[1], NULL, 0);
+        } else if (g_strcmp0(tokens[0], "outfile") == 0) {
+            outfile = g_strdup(tokens[1]);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+    if (!period) {
+        fprintf(stderr, "stackprof: the sampling period must not be 0\n");
+        return -1;
+    }
+
+    n_vcpus = info->system_emulation ? info->system.max_vcpus : 1;
+    vcpus = g_new0(VCPUState, n_vcpus);
+    tbs = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    stale_tbs = g_ptr_array_new_with_free_func(g_free);
+    stacks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -218,7 +218,7 @@ GEN_INPUT_FLUSH3(float64_input_flush3, float64)
 /*
  * Some targets clear the FP flags before most FP operations. This prevents
  * the use of hardfloat, since hardfloat relies on the inexact flag being
- * already set.
+ * already set (unless float_status.lazy_inexact is set).
  */
 #if defined(TARGET_PPC) || defined(__FAST_MATH__)
 # if defined(__FAST_MATH__)
@@ -237,7 +237,8 @@ static inline bool can_use_fpu(const float_status *s)
     if (QEMU_NO_HARDFLOAT) {
         return false;
     }
-    return likely(s->float_exception_flags & float_flag_inexact &&
+    return likely((s->float_exception_flags & float_flag_inexact ||
+                   s->lazy_inexact) &&
                   s->float_rounding_mode == float_round_nearest_even);
 }
 
@@ -886,12 +886,34 @@ static CPUState *gdb_get_cpu(uint32_t pid, uint32_t tid)
     }
 }
 
+static const char *find_feature_xml(CPUState *cpu, const char *p,
+                                    size_t len)
+{
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    const char *name;
+    int i;
+
+    if (cc->gdb_get_dynamic_xml) {
+        char *xmlname = g_strndup(p, len);
+        const char *xml = cc->gdb_get_dynamic_xml(cpu, xmlname);
+
+        g_free(xmlname);
+        if (xml) {
+            return xml;
+        }
+    }
+    for (i = 0; ; i++) {
+        name = xml_builtin[i][0];
+        if (!name || (strncmp(name, p, len) == 0 && strlen(name) == len))
+            break;
+    }
+    return name ? xml_builtin[i][1] : NULL;
+}
+
 static const char *get_feature_xml(const char *p, const char **newp,
                                    GDBProcess *process)
 {
     size_t len;
-    int i;
-    const char *name;
     CPUState *cpu = get_first_cpu_in_process(process);
     CPUClass *cc = CPU_GET_CLASS(cpu);
 
@@ -900,7 +922,6 @@ static const char *get_feature_xml(const char *p, const char **newp,
         len++;
     *newp = p + len;
 
-    name = NULL;
     if (strncmp(p, "target.xml", len) == 0) {
         char *buf = process->target_xml;
         const size_t buf_sz = sizeof(process->target_xml);
@@ -932,24 +953,80 @@ static const char *get_feature_xml(const char *p, const char **newp,
         }
         return buf;
     }
-    if (cc->gdb_get_dynamic_xml) {
-        char *xmlname = g_strndup(p, len);
-        const char *xml = cc->gdb_get_dynamic_xml(cpu, xmlname);
+    return find_feature_xml(cpu, p, len);
+}
 
-        g_free(xmlname);
+/* Get the value of attribute @attr in the XML tag starting at @tag */
+static char *xml_tag_attr(const char *tag, const char *attr)
+{
+    const char *end = strchr(tag, '>');
+    g_autofree char *key = g_strdup_printf(" %s=\"", attr);
+    const char *p = strstr(tag, key);
+    const char *q;
+
+    if (!end || !p || p > end) {
+        return NULL;
+    }
+    p += strlen(key);
+    q = strchr(p, '"');
+    return q && q < end ? g_strndup(p, q - p) : NULL;
+}
+
+/*
+ * Append the registers of the feature described by @xml, numbered from
+ * @base unless they carry a regnum attribute.
+ */
+static void gdb_append_feature_regs(GArray *regs, const char *xml, int base)
+{
+    g_autofree char *feature = NULL;
+    const char *p = strstr(xml, "<feature ");
+    int reg = base;
+
+    if (p) {
+        feature = xml_tag_attr(p, "name");
+    }
+    for (p = strstr(xml, "<reg "); p; p = strstr(p + 1, "<reg ")) {
+        g_autofree char *name = xml_tag_attr(p, "name");
+        g_autofree char *regnum = xml_tag_attr(p, "regnum");
+        GDBRegDesc desc;
+
+        if (regnum) {
+            reg = strtol(regnum, NULL, 0);
+        }
+        if (name) {
+            desc.gdb_reg = reg;
+            desc.name = g_intern_string(name);
+            desc.feature_name = feature ? g_intern_string(feature) : NULL;
+            g_array_append_val(regs, desc);
+        }
+        reg++;
+    }
+}
+
+GArray *gdb_get_register_list(CPUState *cpu)
+{
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    GArray *regs = g_array_new(false, false, sizeof(GDBRegDesc));
+    GDBRegisterState *r;
+    const char *xml;
+
+    if (cc->gdb_core_xml_file) {
+        xml = find_feature_xml(cpu, cc->gdb_core_xml_file,
+                               strlen(cc->gdb_core_xml_file));
         if (xml) {
-            return xml;
+            gdb_append_feature_regs(regs, xml, 0);
         }
     }
-    for (i = 0; ; i++) {
-        name = xml_builtin[i][0];
-        if (!name || (strncmp(name, p, len) == 0 && strlen(name) == len))
-            break;
+    for (r = cpu->gdb_regs; r; r = r->next) {
+        xml = find_feature_xml(cpu, r->xml, strlen(r->xml));
+        if (xml) {
+            gdb_append_feature_regs(regs, xml, r->base_reg);
+        }
     }
-    return name ? xml_builtin[i][1] : NULL;
+    return regs;
 }
 
-static int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg)
+int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg)
 {
     CPUClass *cc = CPU_GET_CLASS(cpu);
     CPUArchState *env = cpu->env_ptr;
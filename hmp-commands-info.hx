@@ -253,6 +253,24 @@ SRST
     Show memory tree.
 ERST
 
+    {
+        .name       = "mmio-profile",
+        .args_type  = "max:i?",
+        .params     = "[max]",
+        .help       = "show the MMIO accounting of I/O memory regions, "
+                      "by decreasing host time (max: only show the first max "
+                      "regions)",
+        .cmd        = hmp_info_mmio_profile,
+    },
+
+SRST
+  ``info mmio-profile`` [*max*]
+    Show, for every I/O memory region accessed since ``mmio-profile on``, the
+    number of reads and writes, the bytes transferred and the host time spent
+    in the device callbacks, by decreasing host time. Only the first *max*
+    regions are shown if *max* is given.
+ERST
+
 #if defined(CONFIG_TCG)
     {
         .name       = "jit",
@@ -281,6 +299,27 @@ SRST
     Show dynamic compiler opcode counters
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tb-stats",
+        .args_type  = "max:i?",
+        .params     = "[max]",
+        .help       = "show the translation statistics of each guest function, "
+                      "by decreasing translation time (max: only show the "
+                      "first max functions)",
+        .cmd        = hmp_info_tb_stats,
+    },
+#endif
+
+SRST
+  ``info tb-stats`` [*max*]
+    Show, for every guest function translated since ``tb-stats on``, the
+    number of translation blocks, the guest and host code sizes, the time
+    spent translating, the number of executions if they are counted and
+    the number of blocks invalidated or flushed, by decreasing translation
+    time. Only the first *max* functions are shown if *max* is given.
+ERST
+
     {
         .name       = "sync-profile",
         .args_type  = "mean:-m,no_coalesce:-n,max:i?",
@@ -633,6 +633,42 @@ SRST
   whether profiling is on or off.
 ERST
 
+    {
+        .name       = "mmio-profile",
+        .args_type  = "op:s?",
+        .params     = "[on|off|reset]",
+        .help       = "enable, disable or reset MMIO accounting. "
+                      "With no arguments, prints whether accounting is on or off.",
+        .cmd        = hmp_mmio_profile,
+    },
+
+SRST
+``mmio-profile [on|off|reset]``
+  Enable, disable or reset the accounting of accesses to I/O memory regions.
+  With no arguments, prints whether accounting is on or off. The statistics
+  are shown by ``info mmio-profile``.
+ERST
+
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tb-stats",
+        .args_type  = "op:s?",
+        .params     = "[on|exec|off|reset]",
+        .help       = "enable, disable or reset the translation statistics "
+                      "per guest function (exec: also count executions). "
+                      "With no arguments, prints whether they are collected.",
+        .cmd        = hmp_tb_stats,
+    },
+#endif
+
+SRST
+``tb-stats [on|exec|off|reset]``
+  Enable, disable or reset the collection of translation statistics per
+  guest function. ``exec`` also counts the executions of the translated
+  code, which flushes the translation cache. With no arguments, prints
+  whether the statistics are collected. They are shown by ``info tb-stats``.
+ERST
+
     {
         .name       = "system_reset",
         .args_type  = "",
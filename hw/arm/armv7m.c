@@ -341,6 +341,12 @@ static void armv7m_realize(DeviceState *dev, Error **errp)
     s->cpu->env.nvic = &s->nvic;
     s->nvic.cpu = s->cpu;
 
+    /*
+     * The SRAM bit-band region must be backed by RAM: the translator
+     * then bypasses the bitband device for it.
+     */
+    s->cpu->inline_bitband = s->enable_bitband && s->inline_bitband;
+
     if (!qdev_realize(DEVICE(s->cpu), NULL, errp)) {
         return;
     }
@@ -526,6 +532,7 @@ static Property armv7m_properties[] = {
     DEFINE_PROP_UINT32("init-svtor", ARMv7MState, init_svtor, 0),
     DEFINE_PROP_UINT32("init-nsvtor", ARMv7MState, init_nsvtor, 0),
     DEFINE_PROP_BOOL("enable-bitband", ARMv7MState, enable_bitband, false),
+    DEFINE_PROP_BOOL("inline-bitband", ARMv7MState, inline_bitband, false),
     DEFINE_PROP_BOOL("start-powered-off", ARMv7MState, start_powered_off,
                      false),
     DEFINE_PROP_BOOL("vfp", ARMv7MState, vfp, true),
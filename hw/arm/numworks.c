@@ -24,20 +24,282 @@
 
 #include "qemu/osdep.h"
 #include "qapi/error.h"
+#include "qapi/qapi-events-run-state.h"
 #include "qapi/qapi-types-ui.h"
+#include "qapi/visitor.h"
 #include "hw/boards.h"
 #include "hw/qdev-properties.h"
 #include "hw/qdev-clock.h"
 #include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "sysemu/cpu-timers.h"
+#include "sysemu/runstate.h"
+#include "disas/disas.h"
 #include "hw/arm/stm32f4xx_soc.h"
 #include "hw/arm/stm32f730_soc.h"
 #include "hw/arm/boot.h"
+#include "hw/loader.h"
+#include "elf.h"
 #include "hw/input/gpio-keypad.h"
 #include "hw/display/st7789v.h"
 #include "hw/arm/numworks.h"
 #include "include/exec/address-spaces.h"
+#include "exec/exec-all.h"
 
 #define ST7789V_ADD 0x60000000
+#define EXTERNAL_FLASH_ADD 0x90000000
+
+/*
+ * Flatten the firmware into raw flash images kept in the flash cache, so
+ * that the flash is mapped from them and only populated on first access
+ * instead of being copied from the ELF file at every reset.
+ */
+static bool numworks_map_flash(NumworksState *s, const char *kernel_filename)
+{
+    NumworksClass *sc = NUMWORKS_GET_CLASS(s);
+    ElfFlatImage images[] = {
+        { .base = sc->flash_base, .size = sc->flash_size },
+        { .base = EXTERNAL_FLASH_ADD, .size = sc->external_flash_size },
+    };
+    int nb_images = sc->external_flash_size ? 2 : 1;
+    Error *err = NULL;
+
+    if (!load_elf_flat_cached(kernel_filename, s->flash_cache,
+                              images, nb_images, &err)) {
+        warn_reportf_err(err, "Loading '%s' without the flash cache: ",
+                         kernel_filename);
+        return false;
+    }
+
+    s->flash_file = images[0].path;
+    s->external_flash_file = images[1].path;
+    return true;
+}
+
+/*
+ * Epsilon does its double precision arithmetic in software, so replace
+ * the AEABI run-time routines, the correctly rounded libm functions and
+ * the memcpy family with host implementations.
+ */
+static void numworks_setup_hle(const char *kernel_filename)
+{
+    ARMCPU *cpu = ARM_CPU(first_cpu);
+    g_autofree ElfSymbolLookup *syms = NULL;
+    Error *err = NULL;
+    uint32_t e_flags;
+    int nb_syms, i;
+
+    nb_syms = 0;
+    while (arm_hle_name(nb_syms)) {
+        nb_syms++;
+    }
+    syms = g_new0(ElfSymbolLookup, nb_syms);
+    for (i = 0; i < nb_syms; i++) {
+        syms[i].name = arm_hle_name(i);
+    }
+
+    if (!load_elf_lookup_symbols(kernel_filename, syms, nb_syms, &e_flags,
+                                 &err)) {
+        warn_reportf_err(err, "Not emulating the run-time library of '%s': ",
+                         kernel_filename);
+        return;
+    }
+
+    for (i = 0; i < nb_syms; i++) {
+        if (syms[i].found) {
+            /* EF_ARM_VFP_FLOAT is EF_ARM_ABI_FLOAT_HARD in EABI v5 */
+            arm_hle_register(cpu, syms[i].name, syms[i].value,
+                             e_flags & EF_ARM_VFP_FLOAT);
+        }
+    }
+}
+
+static void numworks_prefetch_function(const char *name, uint64_t value,
+                                      uint64_t size, void *opaque)
+{
+    NumworksClass *sc = opaque;
+    uint64_t start = value & ~1;
+
+    /* Only the code in flash is immutable */
+    if ((start >= sc->flash_base &&
+         start + size <= sc->flash_base + sc->flash_size) ||
+        (start >= EXTERNAL_FLASH_ADD &&
+         start + size <= EXTERNAL_FLASH_ADD + sc->external_flash_size)) {
+        tb_prefetch_add(start, start + size);
+    }
+}
+
+/*
+ * Translate the functions of the firmware while the CPU waits for events,
+ * so that launching an application doesn't stall on translation.
+ */
+static void numworks_setup_prefetch(NumworksState *s,
+                                    const char *kernel_filename)
+{
+    Error *err = NULL;
+
+    if (!load_elf_foreach_function(kernel_filename,
+                                   numworks_prefetch_function,
+                                   NUMWORKS_GET_CLASS(s), NULL, &err)) {
+        warn_reportf_err(err, "Not translating '%s' ahead of time: ",
+                         kernel_filename);
+    }
+}
+
+/*
+ * Execution budgets stop a firmware that hangs, for instance in a loop
+ * after a crash, without relying on a wall-clock timeout.  With -icount,
+ * both budgets expire at the same guest instruction on every run.
+ */
+#define NUMWORKS_BACKTRACE_DEPTH    16
+#define NUMWORKS_STACK_SCAN         256     /* words */
+
+static void numworks_add_frame(GuestStackFrameList ***tail, uint32_t pc)
+{
+    GuestStackFrame *frame = g_new0(GuestStackFrame, 1);
+    const char *symbol = lookup_symbol(pc);
+
+    frame->pc = pc;
+    if (symbol[0]) {
+        frame->has_symbol = true;
+        frame->symbol = g_strdup(symbol);
+    }
+    QAPI_LIST_APPEND(*tail, frame);
+}
+
+/* Whether the Thumb code address @ret follows a BL or BLX instruction */
+static bool numworks_is_return_address(CPUState *cs, uint32_t ret)
+{
+    uint8_t insn[4];
+    uint16_t hw1, hw2;
+
+    if (!(ret & 1) || ret < 5 ||
+        cpu_memory_rw_debug(cs, (ret & ~1) - 4, insn, sizeof(insn), false)) {
+        return false;
+    }
+    hw1 = lduw_le_p(insn);
+    hw2 = lduw_le_p(insn + 2);
+
+    /* BL and BLX with an immediate, or BLX with a register */
+    return ((hw1 & 0xf800) == 0xf000 && (hw2 & 0xc000) == 0xc000) ||
+           (hw2 & 0xff87) == 0x4780;
+}
+
+/*
+ * Epsilon is built without frame pointers or unwind tables, so the
+ * backtrace is made of the return addresses in LR, in the exception
+ * frame at the entry of a handler and on the stack, where they are
+ * recognized by the call instruction preceding them.
+ */
+static void numworks_backtrace(CPUState *cs, run_on_cpu_data data)
+{
+    GuestStackFrameList **tail = data.host_ptr;
+    CPUARMState *env = &ARM_CPU(cs)->env;
+    uint32_t pc = env->regs[15];
+    uint32_t sp = env->regs[13];
+    uint32_t lr = env->regs[14];
+    uint32_t last = pc;
+    uint8_t word[4];
+    int depth = 1;
+    int i;
+
+    numworks_add_frame(&tail, pc);
+
+    if (env->v7m.exception && (lr & 0xff000000) == 0xff000000) {
+        /* EXC_RETURN: the caller is the PC stacked by the exception */
+        uint32_t frame = (lr & 4) ? env->v7m.other_sp : sp;
+
+        if (!cpu_memory_rw_debug(cs, frame + 24, word, sizeof(word), false)) {
+            last = ldl_le_p(word) & ~1;
+            numworks_add_frame(&tail, last);
+            depth++;
+        }
+        sp = frame + ((lr & 0x10) ? 0x20 : 0x68);
+    } else if (numworks_is_return_address(cs, lr) &&
+               strcmp(lookup_symbol(lr & ~1), lookup_symbol(pc))) {
+        last = lr & ~1;
+        numworks_add_frame(&tail, last);
+        depth++;
+    }
+
+    for (i = 0; i < NUMWORKS_STACK_SCAN && depth < NUMWORKS_BACKTRACE_DEPTH;
+         i++) {
+        uint32_t ret;
+
+        if (cpu_memory_rw_debug(cs, sp + i * 4, word, sizeof(word), false)) {
+            break;
+        }
+        ret = ldl_le_p(word);
+        if (numworks_is_return_address(cs, ret) && (ret & ~1) != last) {
+            last = ret & ~1;
+            numworks_add_frame(&tail, last);
+            depth++;
+        }
+    }
+}
+
+static void numworks_budget_arm(NumworksState *s)
+{
+    int64_t deadline = INT64_MAX;
+
+    if (s->time_budget) {
+        deadline = s->time_budget * NANOSECONDS_PER_SECOND;
+    }
+    if (s->insn_budget) {
+        int64_t left = MAX((int64_t)(s->insn_budget - icount_get_raw()), 1);
+
+        /* Checked again on expiry, as the icount shift may be adaptive */
+        deadline = MIN(deadline, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
+                                 icount_to_ns(left));
+    }
+    timer_mod(s->budget_timer, deadline);
+}
+
+static void numworks_budget_expired(void *opaque)
+{
+    NumworksState *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int64_t insns = icount_enabled() ? icount_get_raw() : 0;
+    GuestStackFrameList *backtrace = NULL, *frame;
+    ExecutionBudget budget;
+
+    if (s->time_budget && now >= s->time_budget * NANOSECONDS_PER_SECOND) {
+        budget = EXECUTION_BUDGET_TIME;
+    } else if (s->insn_budget && (uint64_t)insns >= s->insn_budget) {
+        budget = EXECUTION_BUDGET_INSTRUCTIONS;
+    } else {
+        numworks_budget_arm(s);
+        return;
+    }
+
+    run_on_cpu(first_cpu, numworks_backtrace, RUN_ON_CPU_HOST_PTR(&backtrace));
+
+    error_report("%s budget exhausted after %" PRId64 " ns of virtual time",
+                 budget == EXECUTION_BUDGET_TIME ? "time" : "instruction",
+                 now);
+    for (frame = backtrace; frame; frame = frame->next) {
+        error_printf("  0x%08" PRIx64 " %s\n", frame->value->pc,
+                     frame->value->has_symbol ? frame->value->symbol : "");
+    }
+    qapi_event_send_execution_budget_exceeded(budget, icount_enabled(), insns,
+                                              now, s->budget_action,
+                                              first_cpu->cpu_index,
+                                              backtrace);
+    qapi_free_GuestStackFrameList(backtrace);
+
+    switch (s->budget_action) {
+    case PANIC_ACTION_PAUSE:
+        vm_stop(RUN_STATE_PAUSED);
+        break;
+    case PANIC_ACTION_SHUTDOWN:
+        /* Not a clean poweroff, even for a harness that only checks exit */
+        qemu_system_set_exit_status(EXIT_FAILURE);
+        qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_ERROR);
+        break;
+    default:
+        break;
+    }
+}
 
 static void numworks_init(MachineState *machine)
 {
@@ -47,13 +309,27 @@ static void numworks_init(MachineState *machine)
     DeviceState *gpio;
     DeviceState *dev;
     Clock *sysclk;
+    bool flash_mapped = false;
     int i;
 
     /* This clock doesn't need migration because it is fixed-frequency */
     sysclk = clock_new(OBJECT(machine), "SYSCLK");
     clock_set_hz(sysclk, sc->SysclkFrq);
 
+    if (s->flash_cache && machine->kernel_filename) {
+        flash_mapped = numworks_map_flash(s, machine->kernel_filename);
+    }
+
+    /*
+     * The SoC maps dozens of regions, most of them unimplemented devices;
+     * build the flat views once for all of them rather than once each.
+     */
+    memory_region_transaction_begin();
+
     soc = sc->init(s);
+    if (flash_mapped) {
+        qdev_prop_set_string(soc, "flash-file", s->flash_file);
+    }
     qdev_connect_clock_in(soc, "sysclk", sysclk);
     sysbus_realize(SYS_BUS_DEVICE(soc), &error_fatal);
 
@@ -80,15 +356,206 @@ static void numworks_init(MachineState *machine)
 
     object_unref(OBJECT(soc));
 
+    memory_region_transaction_commit();
+
+    /* With a mapped flash, only the CPU reset handler is left to set up */
     armv7m_load_kernel(ARM_CPU(first_cpu),
-                       machine->kernel_filename,
+                       flash_mapped ? NULL : machine->kernel_filename,
                        sc->flash_size);
+
+    /* Keep the firmware symbols for the disassembler and the TB statistics */
+    if (flash_mapped) {
+        Error *err = NULL;
+
+        if (!load_elf_symbols(machine->kernel_filename, true, &err)) {
+            warn_report_err(err);
+        }
+    }
+
+    if (s->hle && machine->kernel_filename) {
+        numworks_setup_hle(machine->kernel_filename);
+    }
+    if (s->tb_prefetch && machine->kernel_filename) {
+        numworks_setup_prefetch(s, machine->kernel_filename);
+    }
+
+    if (s->insn_budget && !icount_enabled()) {
+        error_report("insn-budget requires -icount");
+        exit(1);
+    }
+    if (s->insn_budget || s->time_budget) {
+        s->budget_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL,
+                                       numworks_budget_expired, s);
+        numworks_budget_arm(s);
+    }
+}
+
+static char *numworks_get_flash_cache(Object *obj, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    return g_strdup(s->flash_cache);
+}
+
+static void numworks_set_flash_cache(Object *obj, const char *value,
+                                     Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    g_free(s->flash_cache);
+    s->flash_cache = g_strdup(value);
+}
+
+static bool numworks_get_hle(Object *obj, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    return s->hle;
+}
+
+static void numworks_set_hle(Object *obj, bool value, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    s->hle = value;
+}
+
+static bool numworks_get_tb_prefetch(Object *obj, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    return s->tb_prefetch;
+}
+
+static void numworks_set_tb_prefetch(Object *obj, bool value, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    s->tb_prefetch = value;
+}
+
+static void numworks_get_insn_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    visit_type_uint64(v, name, &s->insn_budget, errp);
+}
+
+static void numworks_set_insn_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    visit_type_uint64(v, name, &s->insn_budget, errp);
+}
+
+static void numworks_get_time_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    visit_type_uint64(v, name, &s->time_budget, errp);
+}
+
+static void numworks_set_time_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+    uint64_t value;
+
+    if (!visit_type_uint64(v, name, &value, errp)) {
+        return;
+    }
+    if (value > INT64_MAX / NANOSECONDS_PER_SECOND) {
+        error_setg(errp, "time-budget must not exceed %" PRId64 " seconds",
+                   INT64_MAX / NANOSECONDS_PER_SECOND);
+        return;
+    }
+    s->time_budget = value;
+}
+
+static int numworks_get_budget_action(Object *obj, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    return s->budget_action;
+}
+
+static void numworks_set_budget_action(Object *obj, int value, Error **errp)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    s->budget_action = value;
+}
+
+static void numworks_machine_instance_init(Object *obj)
+{
+    NumworksState *s = NUMWORKS(obj);
+
+    s->budget_action = PANIC_ACTION_SHUTDOWN;
 }
 
 static void numworks_machine_class_init(ObjectClass *oc, void *data)
 {
     MachineClass *mc = MACHINE_CLASS(oc);
     mc->init = numworks_init;
+
+    object_class_property_add_str(oc, "flash-cache",
+                                  numworks_get_flash_cache,
+                                  numworks_set_flash_cache);
+    object_class_property_set_description(oc, "flash-cache",
+                                          "Directory in which the firmware "
+                                          "is flattened to flash images "
+                                          "that are mapped instead of "
+                                          "loaded. Instances sharing the "
+                                          "directory share the flash pages");
+
+    object_class_property_add_bool(oc, "hle", numworks_get_hle,
+                                   numworks_set_hle);
+    object_class_property_set_description(oc, "hle",
+                                          "Run the double precision and "
+                                          "memcpy/memset routines of the "
+                                          "firmware's run-time library as "
+                                          "host code (default: off)");
+
+    object_class_property_add_bool(oc, "tb-prefetch",
+                                   numworks_get_tb_prefetch,
+                                   numworks_set_tb_prefetch);
+    object_class_property_set_description(oc, "tb-prefetch",
+                                          "Translate the functions of the "
+                                          "firmware while the CPU is idle "
+                                          "(default: off)");
+
+    object_class_property_add(oc, "insn-budget", "uint64",
+                              numworks_get_insn_budget,
+                              numworks_set_insn_budget, NULL, NULL);
+    object_class_property_set_description(oc, "insn-budget",
+                                          "Guest instructions after which "
+                                          "budget-action is taken, with "
+                                          "-icount (default: 0, unlimited)");
+
+    object_class_property_add(oc, "time-budget", "uint64",
+                              numworks_get_time_budget,
+                              numworks_set_time_budget, NULL, NULL);
+    object_class_property_set_description(oc, "time-budget",
+                                          "Seconds of virtual time after "
+                                          "which budget-action is taken "
+                                          "(default: 0, unlimited)");
+
+    object_class_property_add_enum(oc, "budget-action", "PanicAction",
+                                   &PanicAction_lookup,
+                                   numworks_get_budget_action,
+                                   numworks_set_budget_action);
+    object_class_property_set_description(oc, "budget-action",
+                                          "Action when a budget is "
+                                          "exhausted: pause, shutdown or "
+                                          "none (default: shutdown, and "
+                                          "QEMU exits with status 1)");
 }
 
 
@@ -165,6 +632,7 @@ static void n0100_machine_class_init(ObjectClass *oc, void *data)
     NumworksClass *nc = NUMWORKS_CLASS(oc);
     nc->init = &n0100_init;
     nc->flash_size = STM32F412_SOC_FLASH_SIZE;
+    nc->flash_base = STM32f4XX_FLASH_BASE_ADDRESS;
     nc->RowGPIO = "gpio-e-out";
     nc->ColumnGPIO = "gpio-c";
     nc->SysclkFrq = 100000000ULL;
@@ -176,17 +644,28 @@ static void n0100_machine_class_init(ObjectClass *oc, void *data)
 
 static DeviceState* n0110_init(NumworksState *s)
 {
+    NumworksClass *sc = NUMWORKS_GET_CLASS(s);
     DeviceState *soc;
     Error *err = NULL;
     soc = qdev_new(TYPE_STM32F730_SOC);
     qdev_prop_set_uint32(DEVICE(&STM32F730_SOC(soc)->adc[0]), "value", 0xFFF);
 
-    memory_region_init_rom(&s->external_flash, OBJECT(s), "numworks.external.flash", 8 * MiB, &err);
+    if (s->external_flash_file) {
+        memory_region_init_rom_from_file(&s->external_flash, OBJECT(s),
+                                         "numworks.external.flash",
+                                         sc->external_flash_size,
+                                         s->external_flash_file, &err);
+    } else {
+        memory_region_init_rom(&s->external_flash, OBJECT(s),
+                               "numworks.external.flash",
+                               sc->external_flash_size, &err);
+    }
     if (err != NULL) {
-        assert(false); // Propagate error ?
+        error_report_err(err);
+        exit(1);
     }
     MemoryRegion *system_memory = get_system_memory();
-    memory_region_add_subregion(system_memory, 0x90000000, &s->external_flash);
+    memory_region_add_subregion(system_memory, EXTERNAL_FLASH_ADD, &s->external_flash);
 
     return soc;
 }
@@ -255,6 +734,8 @@ static void n0110_machine_class_init(ObjectClass *oc, void *data)
     NumworksClass *nc = NUMWORKS_CLASS(oc);
     nc->init = &n0110_init;
     nc->flash_size = STM32F730_SOC_FLASH_SIZE;
+    nc->flash_base = STM32F730_FLASH_BASE_ADDRESS_AXIM;
+    nc->external_flash_size = 8 * MiB;
     nc->RowGPIO = "gpio-a-out";
     nc->ColumnGPIO = "gpio-c";
     nc->SysclkFrq = 192000000ULL;
@@ -277,6 +758,7 @@ static const TypeInfo numworks_machine_types[] = {
         .name           = TYPE_NUMWORKS,
         .parent         = TYPE_MACHINE,
         .class_init     = numworks_machine_class_init,
+        .instance_init  = numworks_machine_instance_init,
         .class_size    = sizeof(NumworksClass),
         .instance_size = sizeof(NumworksState),
     },
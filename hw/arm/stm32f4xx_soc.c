@@ -174,8 +174,15 @@ static void stm32f4xx_soc_realize(DeviceState *dev_soc, Error **errp)
     clock_set_mul_div(s->refclk, 8, 1);
     clock_set_source(s->refclk, s->sysclk);
 
-    memory_region_init_rom(&s->flash, OBJECT(dev_soc), "STM32F4XX.flash",
-                           soc_variant->flash_size, &err);
+    if (s->flash_file) {
+        memory_region_init_rom_from_file(&s->flash, OBJECT(dev_soc),
+                                         "STM32F4XX.flash",
+                                         soc_variant->flash_size,
+                                         s->flash_file, &err);
+    } else {
+        memory_region_init_rom(&s->flash, OBJECT(dev_soc), "STM32F4XX.flash",
+                               soc_variant->flash_size, &err);
+    }
     if (err != NULL) {
         error_propagate(errp, err);
         return;
@@ -200,6 +207,7 @@ static void stm32f4xx_soc_realize(DeviceState *dev_soc, Error **errp)
     qdev_prop_set_uint32(armv7m, "num-irq", 96);
     qdev_prop_set_string(armv7m, "cpu-type", ARM_CPU_TYPE_NAME("cortex-m4"));
     qdev_prop_set_bit(armv7m, "enable-bitband", true);
+    qdev_prop_set_bit(armv7m, "inline-bitband", s->inline_bitband);
     qdev_connect_clock_in(armv7m, "cpuclk", s->sysclk);
     qdev_connect_clock_in(armv7m, "refclk", s->refclk);
     object_property_set_link(OBJECT(&s->armv7m), "memory",
@@ -375,6 +383,8 @@ static void stm32f4xx_soc_realize(DeviceState *dev_soc, Error **errp)
 
 static Property stm32f4xx_soc_properties[] = {
     DEFINE_PROP_STRING("soc-type", STM32F4XXState, soc_type),
+    DEFINE_PROP_STRING("flash-file", STM32F4XXState, flash_file),
+    DEFINE_PROP_BOOL("inline-bitband", STM32F4XXState, inline_bitband, true),
     DEFINE_PROP_END_OF_LIST(),
 };
 
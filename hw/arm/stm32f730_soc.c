@@ -28,6 +28,7 @@
 #include "sysemu/sysemu.h"
 #include "hw/arm/stm32f730_soc.h"
 #include "hw/qdev-clock.h"
+#include "hw/qdev-properties.h"
 #include "hw/misc/unimp.h"
 
 #define RCC_ADD                        0x40023800
@@ -153,8 +154,16 @@ static void stm32f730_soc_realize(DeviceState *dev_soc, Error **errp)
     clock_set_mul_div(s->refclk, 8, 1);
     clock_set_source(s->refclk, s->sysclk);
 
-    memory_region_init_rom(&s->flash, OBJECT(dev_soc), "STM32F730.flash.ictm",
-                           STM32F730_SOC_FLASH_SIZE, &err);
+    if (s->flash_file) {
+        memory_region_init_rom_from_file(&s->flash, OBJECT(dev_soc),
+                                         "STM32F730.flash.ictm",
+                                         STM32F730_SOC_FLASH_SIZE,
+                                         s->flash_file, &err);
+    } else {
+        memory_region_init_rom(&s->flash, OBJECT(dev_soc),
+                               "STM32F730.flash.ictm",
+                               STM32F730_SOC_FLASH_SIZE, &err);
+    }
     if (err != NULL) {
         error_propagate(errp, err);
         return;
@@ -179,6 +188,7 @@ static void stm32f730_soc_realize(DeviceState *dev_soc, Error **errp)
     qdev_prop_set_uint32(armv7m, "num-irq", 96);
     qdev_prop_set_string(armv7m, "cpu-type", ARM_CPU_TYPE_NAME("cortex-m7"));
     qdev_prop_set_bit(armv7m, "enable-bitband", true);
+    qdev_prop_set_bit(armv7m, "inline-bitband", s->inline_bitband);
     qdev_connect_clock_in(armv7m, "cpuclk", s->sysclk);
     qdev_connect_clock_in(armv7m, "refclk", s->refclk);
     object_property_set_link(OBJECT(&s->armv7m), "memory",
@@ -363,11 +373,18 @@ static void stm32f730_soc_realize(DeviceState *dev_soc, Error **errp)
     create_unimplemented_device("OTP",         0x1FF07800, 0x210);
 }
 
+static Property stm32f730_soc_properties[] = {
+    DEFINE_PROP_STRING("flash-file", STM32F730State, flash_file),
+    DEFINE_PROP_BOOL("inline-bitband", STM32F730State, inline_bitband, true),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void stm32f730_soc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = stm32f730_soc_realize;
+    device_class_set_props(dc, stm32f730_soc_properties);
     /* No vmstate or reset required: device has no internal state */
 }
 
@@ -29,6 +29,7 @@
 #include "hw/qdev-properties-system.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 
 #ifndef STM_USART_ERR_DEBUG
 #define STM_USART_ERR_DEBUG 0
@@ -219,6 +220,22 @@ static void stm32f2xx_usart_realize(DeviceState *dev, Error **errp)
                              s, NULL, true);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_usart = {
+    .name = TYPE_STM32F2XX_USART,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(usart_sr, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_dr, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_brr, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_cr1, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_cr2, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_cr3, STM32F2XXUsartState),
+        VMSTATE_UINT32(usart_gtpr, STM32F2XXUsartState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_usart_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -226,6 +243,7 @@ static void stm32f2xx_usart_class_init(ObjectClass *klass, void *data)
     dc->reset = stm32f2xx_usart_reset;
     device_class_set_props(dc, stm32f2xx_usart_properties);
     dc->realize = stm32f2xx_usart_realize;
+    dc->vmsd = &vmstate_stm32f2xx_usart;
 }
 
 static const TypeInfo stm32f2xx_usart_info = {
@@ -60,6 +60,7 @@
 #include "exec/memory.h"
 #include "hw/boards.h"
 #include "qemu/cutils.h"
+#include "qemu/units.h"
 #include "sysemu/runstate.h"
 
 #include <zlib.h>
@@ -402,6 +403,302 @@ fail:
     close(fd);
 }
 
+static char *load_elf_hash(const char *filename, Error **errp)
+{
+    g_autoptr(GChecksum) sum = g_checksum_new(G_CHECKSUM_SHA256);
+    g_autofree uint8_t *buf = g_malloc(64 * KiB);
+    ssize_t len;
+    int fd;
+
+    fd = open(filename, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        error_setg_errno(errp, errno, "Failed to open file: %s", filename);
+        return NULL;
+    }
+    while ((len = read(fd, buf, 64 * KiB)) > 0) {
+        g_checksum_update(sum, buf, len);
+    }
+    close(fd);
+    if (len < 0) {
+        error_setg_errno(errp, errno, "Failed to read file: %s", filename);
+        return NULL;
+    }
+
+    return g_strdup(g_checksum_get_string(sum));
+}
+
+static bool load_elf32_ehdr(const uint8_t *elf, size_t elf_size,
+                            struct elf32_hdr *ehdr, bool *must_swab,
+                            Error **errp)
+{
+    if (elf_size < sizeof(*ehdr) || memcmp(elf, ELFMAG, SELFMAG) != 0) {
+        error_setg(errp, "Bad ELF magic");
+        return false;
+    }
+    memcpy(ehdr, elf, sizeof(*ehdr));
+    if (ehdr->e_ident[EI_CLASS] != ELFCLASS32) {
+        error_setg(errp, "Only 32-bit ELF images are supported");
+        return false;
+    }
+    *must_swab = (ehdr->e_ident[EI_DATA] == ELFDATA2MSB) != HOST_BIG_ENDIAN;
+    if (*must_swab) {
+        bswap_ehdr32(ehdr);
+    }
+    return true;
+}
+
+static bool load_elf_flatten(const uint8_t *elf, size_t elf_size,
+                             ElfFlatImage *images, uint8_t **data,
+                             int nb_images, Error **errp)
+{
+    struct elf32_hdr ehdr;
+    struct elf32_phdr phdr;
+    bool must_swab;
+    int i, j;
+
+    if (!load_elf32_ehdr(elf, elf_size, &ehdr, &must_swab, errp)) {
+        return false;
+    }
+    if (ehdr.e_phentsize != sizeof(phdr) ||
+        ehdr.e_phoff + (uint64_t)ehdr.e_phnum * sizeof(phdr) > elf_size) {
+        error_setg(errp, "Bad ELF program headers");
+        return false;
+    }
+
+    for (i = 0; i < ehdr.e_phnum; i++) {
+        memcpy(&phdr, elf + ehdr.e_phoff + i * sizeof(phdr), sizeof(phdr));
+        if (must_swab) {
+            bswap_phdr32(&phdr);
+        }
+        if (phdr.p_type != PT_LOAD || phdr.p_filesz == 0) {
+            continue;
+        }
+        if ((uint64_t)phdr.p_offset + phdr.p_filesz > elf_size) {
+            error_setg(errp, "ELF segment %d is truncated", i);
+            return false;
+        }
+
+        for (j = 0; j < nb_images; j++) {
+            if (phdr.p_paddr >= images[j].base &&
+                (uint64_t)phdr.p_paddr + phdr.p_filesz <=
+                images[j].base + images[j].size) {
+                break;
+            }
+        }
+        if (j == nb_images) {
+            error_setg(errp, "ELF segment at 0x%" PRIx32
+                       " is outside of the flattened ranges", phdr.p_paddr);
+            return false;
+        }
+        memcpy(data[j] + (phdr.p_paddr - images[j].base),
+               elf + phdr.p_offset, phdr.p_filesz);
+    }
+
+    return true;
+}
+
+bool load_elf_flat_cached(const char *filename, const char *cache_dir,
+                          ElfFlatImage *images, int nb_images, Error **errp)
+{
+    g_autofree char *hash = NULL;
+    g_autofree gchar *elf = NULL;
+    uint8_t **data = NULL;
+    GError *gerr = NULL;
+    gsize elf_size;
+    bool cached = true;
+    bool ret = false;
+    int i;
+
+    hash = load_elf_hash(filename, errp);
+    if (!hash) {
+        return false;
+    }
+
+    for (i = 0; i < nb_images; i++) {
+        images[i].path = g_strdup_printf("%s/%s-%" HWADDR_PRIx ".img",
+                                         cache_dir, hash, images[i].base);
+        if (get_image_size(images[i].path) != images[i].size) {
+            cached = false;
+        }
+    }
+    trace_loader_elf_flat(filename, hash, cached);
+    if (cached) {
+        return true;
+    }
+
+    if (!g_file_get_contents(filename, &elf, &elf_size, &gerr)) {
+        error_setg(errp, "Failed to read file: %s", gerr->message);
+        g_error_free(gerr);
+        goto out;
+    }
+
+    data = g_new0(uint8_t *, nb_images);
+    for (i = 0; i < nb_images; i++) {
+        data[i] = g_malloc0(images[i].size);
+    }
+    if (!load_elf_flatten((uint8_t *)elf, elf_size, images, data, nb_images,
+                          errp)) {
+        goto out;
+    }
+
+    /*
+     * g_file_set_contents() renames a temporary file, so concurrent
+     * instances never map a partially written image.
+     */
+    for (i = 0; i < nb_images; i++) {
+        if (!g_file_set_contents(images[i].path, (gchar *)data[i],
+                                 images[i].size, &gerr)) {
+            error_setg(errp, "Failed to write flash image: %s",
+                       gerr->message);
+            g_error_free(gerr);
+            goto out;
+        }
+    }
+    ret = true;
+
+out:
+    for (i = 0; data && i < nb_images; i++) {
+        g_free(data[i]);
+    }
+    g_free(data);
+    for (i = 0; !ret && i < nb_images; i++) {
+        g_free(images[i].path);
+        images[i].path = NULL;
+    }
+    return ret;
+}
+
+bool load_elf_foreach_function(const char *filename, ElfFunctionFn *fn,
+                               void *opaque, uint32_t *pflags, Error **errp)
+{
+    g_autofree gchar *elf = NULL;
+    struct elf32_hdr ehdr;
+    struct elf32_shdr shdr, strtab;
+    struct elf32_sym sym;
+    GError *gerr = NULL;
+    gsize elf_size;
+    bool must_swab;
+    int i, j;
+
+    if (!g_file_get_contents(filename, &elf, &elf_size, &gerr)) {
+        error_setg(errp, "Failed to read file: %s", gerr->message);
+        g_error_free(gerr);
+        return false;
+    }
+    if (!load_elf32_ehdr((uint8_t *)elf, elf_size, &ehdr, &must_swab,
+                         errp)) {
+        return false;
+    }
+    if (ehdr.e_shentsize != sizeof(shdr) ||
+        ehdr.e_shoff + (uint64_t)ehdr.e_shnum * sizeof(shdr) > elf_size) {
+        error_setg(errp, "Bad ELF section headers");
+        return false;
+    }
+    if (pflags) {
+        *pflags = ehdr.e_flags;
+    }
+
+    for (i = 0; i < ehdr.e_shnum; i++) {
+        memcpy(&shdr, elf + ehdr.e_shoff + i * sizeof(shdr), sizeof(shdr));
+        if (must_swab) {
+            bswap_shdr32(&shdr);
+        }
+        if (shdr.sh_type != SHT_SYMTAB) {
+            continue;
+        }
+        if (shdr.sh_link >= ehdr.e_shnum ||
+            (uint64_t)shdr.sh_offset + shdr.sh_size > elf_size) {
+            error_setg(errp, "Bad ELF symbol table");
+            return false;
+        }
+        memcpy(&strtab, elf + ehdr.e_shoff + shdr.sh_link * sizeof(strtab),
+               sizeof(strtab));
+        if (must_swab) {
+            bswap_shdr32(&strtab);
+        }
+        if ((uint64_t)strtab.sh_offset + strtab.sh_size > elf_size ||
+            strtab.sh_size == 0 ||
+            elf[strtab.sh_offset + strtab.sh_size - 1] != '\0') {
+            error_setg(errp, "Bad ELF string table");
+            return false;
+        }
+
+        for (j = 0; j < shdr.sh_size / sizeof(sym); j++) {
+            memcpy(&sym, elf + shdr.sh_offset + j * sizeof(sym), sizeof(sym));
+            if (must_swab) {
+                bswap_sym32(&sym);
+            }
+            if (ELF32_ST_TYPE(sym.st_info) != STT_FUNC ||
+                sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE ||
+                sym.st_name >= strtab.sh_size) {
+                continue;
+            }
+            fn(elf + strtab.sh_offset + sym.st_name, sym.st_value,
+               sym.st_size, opaque);
+        }
+    }
+    return true;
+}
+
+typedef struct ElfLookupState {
+    GHashTable *names;
+    ElfSymbolLookup *syms;
+} ElfLookupState;
+
+static void load_elf_lookup_symbol(const char *name, uint64_t value,
+                                   uint64_t size, void *opaque)
+{
+    ElfLookupState *s = opaque;
+    gpointer idx = g_hash_table_lookup(s->names, name);
+
+    if (idx) {
+        s->syms[GPOINTER_TO_INT(idx) - 1].value = value;
+        s->syms[GPOINTER_TO_INT(idx) - 1].found = true;
+    }
+}
+
+bool load_elf_lookup_symbols(const char *filename, ElfSymbolLookup *syms,
+                             int nb_syms, uint32_t *pflags, Error **errp)
+{
+    g_autoptr(GHashTable) names = g_hash_table_new(g_str_hash, g_str_equal);
+    ElfLookupState s = { .names = names, .syms = syms };
+    int i;
+
+    for (i = 0; i < nb_syms; i++) {
+        syms[i].found = false;
+        g_hash_table_insert(names, (gpointer)syms[i].name,
+                            GINT_TO_POINTER(i + 1));
+    }
+    return load_elf_foreach_function(filename, load_elf_lookup_symbol, &s,
+                                     pflags, errp);
+}
+
+bool load_elf_symbols(const char *filename, bool clear_lsb, Error **errp)
+{
+    uint8_t buf[sizeof(struct elf32_hdr)];
+    struct elf32_hdr ehdr;
+    bool must_swab;
+    int fd;
+
+    fd = open(filename, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        error_setg_errno(errp, errno, "Failed to open file");
+        return false;
+    }
+    if (read(fd, buf, sizeof(buf)) != sizeof(buf)) {
+        error_setg(errp, "Failed to read the ELF header");
+        close(fd);
+        return false;
+    }
+    if (!load_elf32_ehdr(buf, sizeof(buf), &ehdr, &must_swab, errp)) {
+        close(fd);
+        return false;
+    }
+    load_symbols32(&ehdr, fd, must_swab, clear_lsb, NULL);
+    close(fd);
+    return true;
+}
+
 /* return < 0 if error, otherwise the number of bytes loaded in memory */
 ssize_t load_elf(const char *filename,
                  uint64_t (*elf_note_fn)(void *, void *, bool),
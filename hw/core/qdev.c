@@ -33,6 +33,8 @@
 #include "qapi/visitor.h"
 #include "qemu/error-report.h"
 #include "qemu/option.h"
+#include "qemu/startup-profile.h"
+#include "qemu/timer.h"
 #include "hw/irq.h"
 #include "hw/qdev-properties.h"
 #include "hw/boards.h"
@@ -550,10 +552,17 @@ static void device_set_realized(Object *obj, bool value, Error **errp)
         }
 
         if (dc->realize) {
+            int64_t start = startup_profile_enabled ? get_clock() : 0;
+
             dc->realize(dev, &local_err);
             if (local_err != NULL) {
                 goto fail;
             }
+            if (start) {
+                startup_profile_account(STARTUP_PROFILE_REALIZE,
+                                        object_get_typename(obj),
+                                        get_clock() - start);
+            }
         }
 
         DEVICE_LISTENER_CALL(realize, Forward, dev);
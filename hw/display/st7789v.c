@@ -28,9 +28,14 @@
 #include "hw/display/framebuffer.h"
 #include "hw/display/st7789v.h"
 #include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
+#include "qemu/host-utils.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qemu/timer.h"
 #include "qapi/error.h"
+#include "qapi/qapi-visit-ui.h"
+#include "qapi/visitor.h"
 #include "qom/object.h"
 #include "trace.h"
 
@@ -113,6 +118,168 @@ static inline void st7789v_postop(ST7789VState *s)
     }
 }
 
+/*
+ * Rendering telemetry.  A frame is a refresh period of the panel in
+ * virtual time, 60 Hz out of reset.  Only commands read the clocks, so
+ * a memory write burst lasts from the MEMORY_WRITE command to the next
+ * command, and a frame is closed by the first command after its end.
+ */
+#define ST7789V_FRAME_NS (NANOSECONDS_PER_SECOND / 60)
+
+static int st7789v_bucket(uint64_t value, int buckets)
+{
+    return value < 2 ? 0 : MIN(63 - clz64(value), buckets - 1);
+}
+
+static void st7789v_burst_account(ST7789VState *s, int64_t virt_ns,
+                                  int64_t host_ns)
+{
+    ST7789VFrameStats *st = &s->stats;
+
+    trace_st7789v_burst(s, s->xs, s->xe, s->ys, s->ye, st->burst_pixels,
+                        virt_ns, host_ns);
+    st->frame.burst_ns += virt_ns;
+    st->frame.host_ns += host_ns;
+}
+
+static void st7789v_burst_end(ST7789VState *s, int64_t now)
+{
+    ST7789VFrameStats *st = &s->stats;
+
+    st7789v_burst_account(s, MAX(now - st->burst_start, 0),
+                          get_clock() - st->burst_host_start);
+    st->in_burst = false;
+}
+
+static void st7789v_burst_start(ST7789VState *s, int64_t now)
+{
+    ST7789VFrameStats *st = &s->stats;
+
+    st->in_burst = true;
+    st->burst_pixels = 0;
+    st->burst_start = now;
+    st->burst_host_start = get_clock();
+}
+
+static void st7789v_frame_end(ST7789VState *s)
+{
+    ST7789VFrameStats *st = &s->stats;
+    ST7789VFrameCounters *f = &st->frame;
+
+    if (f->bursts || f->window_changes || f->pixels || f->burst_ns) {
+        trace_st7789v_frame(s, st->index, f->pixels, f->window_changes,
+                            f->bursts, f->burst_ns, f->host_ns);
+        st->frames++;
+        if (f->pixels >= s->width * s->height) {
+            st->full_redraws++;
+        }
+        st->pixels_histogram[st7789v_bucket(f->pixels,
+                                            ST7789V_PIXELS_BUCKETS)]++;
+        st->burst_ns_histogram[st7789v_bucket(f->burst_ns / SCALE_US,
+                                              ST7789V_BURST_NS_BUCKETS)]++;
+        st->total.pixels += f->pixels;
+        st->total.window_changes += f->window_changes;
+        st->total.bursts += f->bursts;
+        st->total.burst_ns += f->burst_ns;
+        st->total.host_ns += f->host_ns;
+    }
+    memset(f, 0, sizeof(*f));
+}
+
+/*
+ * Close the frame under way if @now is past it.  A burst that crosses
+ * frame ends is split at each of them, so every period it covers gets
+ * its own frame, and the host time spent so far is shared out in
+ * proportion to the virtual time of each part.
+ */
+static void st7789v_frame_update(ST7789VState *s, int64_t now)
+{
+    ST7789VFrameStats *st = &s->stats;
+    int64_t index = now / ST7789V_FRAME_NS;
+    int64_t boundary, virt_ns, host_ns, virt_left, host_left;
+
+    if (index == st->index) {
+        return;
+    }
+
+    if (!st->in_burst) {
+        st7789v_frame_end(s);
+        st->index = index;
+        return;
+    }
+
+    virt_left = MAX(now - st->burst_start, 0);
+    host_left = get_clock() - st->burst_host_start;
+    while (st->index < index) {
+        boundary = MIN(now, (st->index + 1) * ST7789V_FRAME_NS);
+        boundary = MAX(boundary, st->burst_start);
+        virt_ns = boundary - st->burst_start;
+        host_ns = virt_left ? (double)host_left * virt_ns / virt_left : 0;
+        st7789v_burst_account(s, virt_ns, host_ns);
+        st7789v_frame_end(s);
+        virt_left -= virt_ns;
+        host_left -= host_ns;
+        st->burst_pixels = 0;
+        st->burst_start = boundary;
+        st->index++;
+    }
+    /* the rest of the host time goes to the remainder of the burst */
+    st->burst_host_start = get_clock() - host_left;
+}
+
+static void st7789v_account_command(ST7789VState *s, uint16_t cmd)
+{
+    ST7789VFrameStats *st = &s->stats;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    st7789v_frame_update(s, now);
+    if (st->in_burst) {
+        st7789v_burst_end(s, now);
+    }
+
+    switch (cmd) {
+    case ST7789V_COLUMN_ADDRESS_SET:
+    case ST7789V_ROW_ADDRESS_SET:
+        st->frame.window_changes++;
+        break;
+    case ST7789V_MEMORY_WRITE:
+        st->frame.bursts++;
+        st7789v_burst_start(s, now);
+        break;
+    }
+}
+
+static void st7789v_get_frame_stats(Object *obj, Visitor *v, const char *name,
+                                    void *opaque, Error **errp)
+{
+    ST7789VState *s = ST7789V(obj);
+    ST7789VFrameStats *st = &s->stats;
+    DisplayFrameStats *stats = g_new0(DisplayFrameStats, 1);
+    intList **tail;
+    int i;
+
+    st7789v_frame_update(s, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+
+    stats->frames = st->frames;
+    stats->pixels = st->total.pixels;
+    stats->window_changes = st->total.window_changes;
+    stats->bursts = st->total.bursts;
+    stats->burst_ns = st->total.burst_ns;
+    stats->host_ns = st->total.host_ns;
+    stats->full_redraws = st->full_redraws;
+    tail = &stats->pixels_histogram;
+    for (i = 0; i < ST7789V_PIXELS_BUCKETS; i++) {
+        QAPI_LIST_APPEND(tail, st->pixels_histogram[i]);
+    }
+    tail = &stats->burst_ns_histogram;
+    for (i = 0; i < ST7789V_BURST_NS_BUCKETS; i++) {
+        QAPI_LIST_APPEND(tail, st->burst_ns_histogram[i]);
+    }
+
+    visit_type_DisplayFrameStats(v, name, &stats, errp);
+    qapi_free_DisplayFrameStats(stats);
+}
+
 static void st7789v_reset(DeviceState *dev)
 {
     ST7789VState *s = ST7789V(dev);
@@ -378,6 +545,7 @@ static void st7789v_write(void *opaque, hwaddr addr, uint64_t val64,
 
     switch (addr) {
     case ST7789V_COMMAND:
+        st7789v_account_command(s, value);
         switch (value) {
         case ST7789V_NOP:
             break;
@@ -559,6 +727,8 @@ static void st7789v_write(void *opaque, hwaddr addr, uint64_t val64,
                 s->vram[y * s->width + x] = rgb_to_pixel32(r, g, b);
                 memory_region_set_dirty(&s->framebuffer, y * s->width + x, 4);
             }
+            s->stats.frame.pixels++;
+            s->stats.burst_pixels++;
 
             st7789v_postop(s);
             break;
@@ -581,6 +751,52 @@ static const MemoryRegionOps st7789v_mmio_ops = {
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
+static int st7789v_post_load(void *opaque, int version_id)
+{
+    ST7789VState *s = opaque;
+
+    s->invalidate = 1;
+    return 0;
+}
+
+static const VMStateDescription vmstate_st7789v = {
+    .name = TYPE_ST7789V,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = st7789v_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(state, ST7789VState),
+        VMSTATE_BOOL(bston, ST7789VState),
+        VMSTATE_BOOL(my, ST7789VState),
+        VMSTATE_BOOL(mx, ST7789VState),
+        VMSTATE_BOOL(mv, ST7789VState),
+        VMSTATE_BOOL(ml, ST7789VState),
+        VMSTATE_BOOL(rgb, ST7789VState),
+        VMSTATE_BOOL(mh, ST7789VState),
+        VMSTATE_UINT8(ifpf, ST7789VState),
+        VMSTATE_BOOL(idmon, ST7789VState),
+        VMSTATE_BOOL(ptlon, ST7789VState),
+        VMSTATE_BOOL(slpout, ST7789VState),
+        VMSTATE_BOOL(noron, ST7789VState),
+        VMSTATE_BOOL(vsson, ST7789VState),
+        VMSTATE_BOOL(invon, ST7789VState),
+        VMSTATE_BOOL(dison, ST7789VState),
+        VMSTATE_BOOL(teon, ST7789VState),
+        VMSTATE_UINT8(gcsel, ST7789VState),
+        VMSTATE_BOOL(tem, ST7789VState),
+        VMSTATE_UINT8(rgb_fmt, ST7789VState),
+        VMSTATE_UINT8(ctrl_fmt, ST7789VState),
+        VMSTATE_UINT16(xs, ST7789VState),
+        VMSTATE_UINT16(xe, ST7789VState),
+        VMSTATE_UINT16(ys, ST7789VState),
+        VMSTATE_UINT16(ye, ST7789VState),
+        VMSTATE_UINT32(memory_read_step, ST7789VState),
+        VMSTATE_INT32(col, ST7789VState),
+        VMSTATE_INT32(row, ST7789VState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static Property st7789v_properties[] = {
     DEFINE_PROP_UINT32("display-id", ST7789VState, display_id, 0x858552),
     DEFINE_PROP_UINT32("width", ST7789VState, width, 240),
@@ -636,8 +852,12 @@ static void st7789v_class_init(ObjectClass *oc, void *data)
     set_bit(DEVICE_CATEGORY_DISPLAY, dc->categories);
     dc->realize = st7789v_realize;
     dc->reset = st7789v_reset;
+    dc->vmsd = &vmstate_st7789v;
 
-    /* Note: This device does not any state that we have to reset or migrate */
+    object_class_property_add(oc, "frame-stats", "DisplayFrameStats",
+                              st7789v_get_frame_stats, NULL, NULL, NULL);
+    object_class_property_set_description(oc, "frame-stats",
+        "Rendering statistics per refresh period of the panel");
 }
 
 static const TypeInfo st7789v_info = {
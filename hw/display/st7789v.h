@@ -90,6 +90,34 @@ typedef enum MemoryReadSteps {
     THIRD_TRANSACTION,
 } MemoryReadSteps;
 
+#define ST7789V_PIXELS_BUCKETS      18
+#define ST7789V_BURST_NS_BUCKETS    17
+
+/* Rendering telemetry, not migrated as it is not guest visible */
+typedef struct ST7789VFrameCounters {
+    uint64_t pixels;
+    uint64_t window_changes;
+    uint64_t bursts;
+    int64_t burst_ns;
+    int64_t host_ns;
+} ST7789VFrameCounters;
+
+typedef struct ST7789VFrameStats {
+    int64_t index;              /* frame under way, in refresh periods */
+    ST7789VFrameCounters frame;
+
+    bool in_burst;
+    uint32_t burst_pixels;
+    int64_t burst_start;
+    int64_t burst_host_start;
+
+    uint64_t frames;
+    uint64_t full_redraws;
+    ST7789VFrameCounters total;
+    uint64_t pixels_histogram[ST7789V_PIXELS_BUCKETS];
+    uint64_t burst_ns_histogram[ST7789V_BURST_NS_BUCKETS];
+} ST7789VFrameStats;
+
 struct ST7789VState {
     SysBusDevice parent_obj;
 
@@ -105,7 +133,7 @@ struct ST7789VState {
     QemuConsole *con;
     int invalidate;
 
-    ST7789VStateMachine state;
+    uint32_t state; /* ST7789VStateMachine */
 
     bool bston;
     bool my;
@@ -136,10 +164,12 @@ struct ST7789VState {
     uint16_t ys;
     uint16_t ye;
 
-    MemoryReadSteps memory_read_step;
+    uint32_t memory_read_step; /* MemoryReadSteps */
 
     int col;
     int row;
+
+    ST7789VFrameStats stats;
 };
 
 #endif
@@ -18,6 +18,7 @@
 #include "hw/gpio/stm32f2xx_gpio.h"
 #include "hw/irq.h"
 #include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
 #include "qapi/error.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
@@ -196,6 +197,23 @@ static void stm32f2xx_gpio_init(Object *obj)
     qdev_init_gpio_out(dev, s->output, STM32F2XX_GPIO_NR_PINS);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_gpio = {
+    .name = TYPE_STM32F2XX_GPIO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(mode, STM32F2xxGpioState),
+        VMSTATE_UINT16(otype, STM32F2xxGpioState),
+        VMSTATE_UINT32(ospeed, STM32F2xxGpioState),
+        VMSTATE_UINT32(pupd, STM32F2xxGpioState),
+        VMSTATE_UINT16(idr, STM32F2xxGpioState),
+        VMSTATE_UINT16(odr, STM32F2xxGpioState),
+        VMSTATE_UINT32(afrl, STM32F2xxGpioState),
+        VMSTATE_UINT32(afrh, STM32F2xxGpioState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static Property stm32f2xx_gpio_properties[] = {
     DEFINE_PROP_UINT32("reset-mode", STM32F2xxGpioState, reset_mode, 0),
     DEFINE_PROP_UINT32("reset-ospeed", STM32F2xxGpioState, reset_ospeed, 0),
@@ -211,6 +229,7 @@ static void stm32f2xx_gpio_class_init(ObjectClass *klass, void *data)
     dc->desc = "STM32F2xx GPIO Controller";
     reset->phases.enter = stm32f2xx_gpio_enter_reset;
     reset->phases.hold = stm32f2xx_gpio_hold_reset;
+    dc->vmsd = &vmstate_stm32f2xx_gpio;
     device_class_set_props(dc, stm32f2xx_gpio_properties);
 }
 
@@ -22,6 +22,7 @@
 #include "ui/input.h"
 #include "qapi/error.h"
 #include "qapi/visitor.h"
+#include "migration/vmstate.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
 #include "qom/object.h"
@@ -246,6 +247,18 @@ const PropertyInfo gpio_keypad_key_property_info = {
     .set   = set_keypad_key,
 };
 
+static const VMStateDescription vmstate_gpio_keypad = {
+    .name = TYPE_GPIO_KEYPAD,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(input, GpioKeypadState),
+        VMSTATE_2DARRAY(keypad_status, GpioKeypadState, GPIO_KEYPAD_NR_PINS,
+                        GPIO_KEYPAD_NR_PINS, 0, vmstate_info_bool, bool),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static Property gpio_keypad_properties[] = {
     DEFINE_PROP_BOOL("active-low", GpioKeypadState, active_low, 0),
     DEFINE_PROP_UINT32("num-rows", GpioKeypadState, num_rows, 0),
@@ -269,6 +282,7 @@ static void gpio_keypad_class_init(ObjectClass *oc, void *data)
 
     dc->desc = "GPIO-based keypad keyboard";
     dc->realize = gpio_keypad_realize;
+    dc->vmsd = &vmstate_gpio_keypad;
     device_class_set_props(dc, gpio_keypad_properties);
 }
 
@@ -1560,6 +1560,92 @@ static uint32_t nvic_readl(NVICState *s, uint32_t offset, MemTxAttrs attrs)
     }
 }
 
+/*
+ * Return the address range [*base, *limit] covered by MPU region @region
+ * of the given security state, or false if the region cannot match any
+ * address (disabled or with an invalid size or alignment).
+ */
+static bool mpu_region_extent(ARMCPU *cpu, bool secure, int region,
+                              uint32_t *base, uint32_t *limit)
+{
+    CPUARMState *env = &cpu->env;
+
+    if (arm_feature(env, ARM_FEATURE_V8)) {
+        uint32_t rlar = env->pmsav8.rlar[secure][region];
+
+        if (!(rlar & 0x1)) {
+            return false;
+        }
+        *base = env->pmsav8.rbar[secure][region] & ~0x1f;
+        *limit = rlar | 0x1f;
+        return *base <= *limit;
+    } else {
+        uint32_t drsr = env->pmsav7.drsr[region];
+        uint32_t rsize = extract32(drsr, 1, 5);
+        uint64_t rmask;
+
+        if (!(drsr & 1) || !rsize) {
+            return false;
+        }
+        rmask = (1ull << (rsize + 1)) - 1;
+        *base = env->pmsav7.drbar[region];
+        if (*base & rmask) {
+            return false;
+        }
+        *limit = *base + rmask;
+        return true;
+    }
+}
+
+/* The MMU indexes whose translations depend on the given MPU bank */
+static uint16_t mpu_mmuidx_map(bool secure)
+{
+    if (secure) {
+        return ARMMMUIdxBit_MSUser | ARMMMUIdxBit_MSPriv |
+               ARMMMUIdxBit_MSUserNegPri | ARMMMUIdxBit_MSPrivNegPri;
+    }
+    return ARMMMUIdxBit_MUser | ARMMMUIdxBit_MPriv |
+           ARMMMUIdxBit_MUserNegPri | ARMMMUIdxBit_MPrivNegPri;
+}
+
+static void mpu_flush_range(ARMCPU *cpu, uint16_t idxmap,
+                            uint32_t base, uint32_t limit)
+{
+    base &= TARGET_PAGE_MASK;
+    limit |= ~TARGET_PAGE_MASK;
+    if (base == 0 && limit == UINT32_MAX) {
+        tlb_flush_by_mmuidx(CPU(cpu), idxmap);
+    } else {
+        tlb_flush_range_by_mmuidx(CPU(cpu), base, limit - base + 1,
+                                  idxmap, TARGET_LONG_BITS);
+    }
+}
+
+/*
+ * Flush the TLB entries that may depend on MPU region @region, whose old
+ * extent is described by @old_valid, @old_base and @old_limit. Only the
+ * addresses in the old or the new extent of the region can translate
+ * differently, and only for the MMU indexes of the security state that
+ * owns the region; everything else keeps its TLB entries.
+ */
+static void mpu_region_flush(ARMCPU *cpu, bool secure, int region,
+                             bool old_valid, uint32_t old_base,
+                             uint32_t old_limit)
+{
+    uint16_t idxmap = mpu_mmuidx_map(secure);
+    uint32_t base, limit;
+    bool valid = mpu_region_extent(cpu, secure, region, &base, &limit);
+
+    if (old_valid) {
+        trace_nvic_mpu_region_flush(secure, region, old_base, old_limit);
+        mpu_flush_range(cpu, idxmap, old_base, old_limit);
+    }
+    if (valid && !(old_valid && base == old_base && limit == old_limit)) {
+        trace_nvic_mpu_region_flush(secure, region, base, limit);
+        mpu_flush_range(cpu, idxmap, base, limit);
+    }
+}
+
 static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
                         MemTxAttrs attrs)
 {
@@ -1838,6 +1924,9 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
     case 0xd90: /* MPU_TYPE */
         return; /* RO */
     case 0xd94: /* MPU_CTRL */
+    {
+        uint32_t old_ctrl = cpu->env.v7m.mpu_ctrl[attrs.secure];
+
         if ((value &
              (R_V7M_MPU_CTRL_HFNMIENA_MASK | R_V7M_MPU_CTRL_ENABLE_MASK))
             == R_V7M_MPU_CTRL_HFNMIENA_MASK) {
@@ -1848,8 +1937,12 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             = value & (R_V7M_MPU_CTRL_ENABLE_MASK |
                        R_V7M_MPU_CTRL_HFNMIENA_MASK |
                        R_V7M_MPU_CTRL_PRIVDEFENA_MASK);
-        tlb_flush(CPU(cpu));
+        if (cpu->env.v7m.mpu_ctrl[attrs.secure] != old_ctrl) {
+            /* This can change the translation of any address */
+            tlb_flush_by_mmuidx(CPU(cpu), mpu_mmuidx_map(attrs.secure));
+        }
         break;
+    }
     case 0xd98: /* MPU_RNR */
         if (value >= cpu->pmsav7_dregion) {
             qemu_log_mask(LOG_GUEST_ERROR, "MPU region out of range %"
@@ -1864,6 +1957,8 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
     case 0xdac: /* MPU_RBAR_A2 */
     case 0xdb4: /* MPU_RBAR_A3 */
     {
+        uint32_t old_base, old_limit;
+        bool old_valid;
         int region;
 
         if (arm_feature(&cpu->env, ARM_FEATURE_V8)) {
@@ -1881,8 +1976,11 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             if (region >= cpu->pmsav7_dregion) {
                 return;
             }
+            old_valid = mpu_region_extent(cpu, attrs.secure, region,
+                                          &old_base, &old_limit);
             cpu->env.pmsav8.rbar[attrs.secure][region] = value;
-            tlb_flush(CPU(cpu));
+            mpu_region_flush(cpu, attrs.secure, region,
+                             old_valid, old_base, old_limit);
             return;
         }
 
@@ -1906,8 +2004,12 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             return;
         }
 
+        old_valid = mpu_region_extent(cpu, attrs.secure, region,
+                                      &old_base, &old_limit);
         cpu->env.pmsav7.drbar[region] = value & ~0x1f;
-        tlb_flush(CPU(cpu));
+        cpu->env.pmsav7.map_valid = false;
+        mpu_region_flush(cpu, attrs.secure, region,
+                         old_valid, old_base, old_limit);
         break;
     }
     case 0xda0: /* MPU_RASR (v7M), MPU_RLAR (v8M) */
@@ -1916,6 +2018,8 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
     case 0xdb8: /* MPU_RASR_A3 (v7M), MPU_RLAR_A3 (v8M) */
     {
         int region = cpu->env.pmsav7.rnr[attrs.secure];
+        uint32_t old_base, old_limit;
+        bool old_valid;
 
         if (arm_feature(&cpu->env, ARM_FEATURE_V8)) {
             /* PMSAv8M handling of the aliases is different from v7M:
@@ -1931,8 +2035,11 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             if (region >= cpu->pmsav7_dregion) {
                 return;
             }
+            old_valid = mpu_region_extent(cpu, attrs.secure, region,
+                                          &old_base, &old_limit);
             cpu->env.pmsav8.rlar[attrs.secure][region] = value;
-            tlb_flush(CPU(cpu));
+            mpu_region_flush(cpu, attrs.secure, region,
+                             old_valid, old_base, old_limit);
             return;
         }
 
@@ -1940,9 +2047,13 @@ static void nvic_writel(NVICState *s, uint32_t offset, uint32_t value,
             return;
         }
 
+        old_valid = mpu_region_extent(cpu, attrs.secure, region,
+                                      &old_base, &old_limit);
         cpu->env.pmsav7.drsr[region] = value & 0xff3f;
         cpu->env.pmsav7.dracr[region] = (value >> 16) & 0x173f;
-        tlb_flush(CPU(cpu));
+        cpu->env.pmsav7.map_valid = false;
+        mpu_region_flush(cpu, attrs.secure, region,
+                         old_valid, old_base, old_limit);
         break;
     }
     case 0xdc0: /* MPU_MAIR0 */
@@ -26,6 +26,7 @@
 #include "hw/misc/stm32f2xx_crc.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 #include "hw/qdev-clock.h"
 
@@ -118,11 +119,23 @@ static void stm32f2xx_crc_init(Object *obj)
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_crc = {
+    .name = TYPE_STM32F2XX_CRC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(DR, STM32F2XXCrcState),
+        VMSTATE_UINT8(IDR, STM32F2XXCrcState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_crc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = stm32f2xx_crc_reset;
+    dc->vmsd = &vmstate_stm32f2xx_crc;
 }
 
 static const TypeInfo stm32f2xx_crc_info = {
@@ -26,6 +26,7 @@
 #include "hw/misc/stm32f2xx_pwr.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 #include "hw/qdev-clock.h"
 
@@ -103,11 +104,23 @@ static void stm32f2xx_pwr_init(Object *obj)
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_pwr = {
+    .name = TYPE_STM32F2XX_PWR,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(cr1, STM32F2XXPwrState),
+        VMSTATE_UINT32(csr1, STM32F2XXPwrState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_pwr_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = stm32f2xx_pwr_reset;
+    dc->vmsd = &vmstate_stm32f2xx_pwr;
 }
 
 static const TypeInfo stm32f2xx_pwr_info = {
@@ -26,6 +26,7 @@
 #include "hw/misc/stm32f2xx_rcc.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 #include "hw/qdev-clock.h"
 
@@ -37,6 +38,20 @@ static void stm32f2xx_rcc_reset(DeviceState *dev)
     s->rcc_cfgr = 0x00000000;
 }
 
+static void stm32f2xx_rcc_update_refclk(STM32F2XXRccState *s)
+{
+    uint8_t AHBPrescalar = (s->rcc_cfgr & 240) >> 4;
+
+    if (AHBPrescalar == 0) {
+        clock_set_mul_div(s->refclk, 8, 1);
+    } else if (AHBPrescalar == 9) {
+        clock_set_mul_div(s->refclk, 32, 1);
+    } else {
+        qemu_log_mask(LOG_UNIMP, "%s : Unimplemented AHBPrescalar\n", __func__);
+    }
+    clock_propagate(s->refclk->source->source);
+}
+
 static uint64_t stm32f2xx_rcc_read(void *opaque, hwaddr addr,
                                      unsigned int size)
 {
@@ -82,20 +97,11 @@ static void stm32f2xx_rcc_write(void *opaque, hwaddr addr,
             break;
         }
         case RCC_CFGR: {
-            uint8_t AHBPrescalar = (value & 240) >> 4;
-
             value &= ~0xC;
             value |= (value & 0x3) << 2;
             s->rcc_cfgr = value;
 
-            if (AHBPrescalar == 0) {
-                clock_set_mul_div(s->refclk, 8, 1);
-            } else if (AHBPrescalar == 9) {
-                clock_set_mul_div(s->refclk, 32, 1);
-            } else {
-                qemu_log_mask(LOG_UNIMP, "%s : Unimplemented AHBPrescalar\n", __func__);
-            }
-            clock_propagate(s->refclk->source->source);
+            stm32f2xx_rcc_update_refclk(s);
             break;
         }
         default: {
@@ -121,11 +127,33 @@ static void stm32f2xx_rcc_init(Object *obj)
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
+static int stm32f2xx_rcc_post_load(void *opaque, int version_id)
+{
+    STM32F2XXRccState *s = opaque;
+
+    /* The refclk divider is derived from CFGR and is not migrated itself */
+    stm32f2xx_rcc_update_refclk(s);
+    return 0;
+}
+
+static const VMStateDescription vmstate_stm32f2xx_rcc = {
+    .name = TYPE_STM32F2XX_RCC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = stm32f2xx_rcc_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(rcc_cr, STM32F2XXRccState),
+        VMSTATE_UINT32(rcc_cfgr, STM32F2XXRccState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_rcc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = stm32f2xx_rcc_reset;
+    dc->vmsd = &vmstate_stm32f2xx_rcc;
 }
 
 static const TypeInfo stm32f2xx_rcc_info = {
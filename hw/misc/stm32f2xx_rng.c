@@ -26,14 +26,37 @@
 #include "hw/misc/stm32f2xx_rng.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 #include "qemu/guest-random.h"
 
 
+/*
+ * DR is fed from a xorshift64* generator that is seeded from the guest
+ * entropy source on reset.  Calling qemu_guest_getrandom() on every read
+ * would store an EVENT_RANDOM in the record/replay log for each access to
+ * DR; seeding once keeps replays deterministic with a single event per
+ * reset, and honours -seed like any other guest entropy.
+ */
+static uint32_t stm32f2xx_rng_next(STM32F2XXRngState *s)
+{
+    uint64_t x = s->state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    s->state = x;
+
+    return (x * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
 static void stm32f2xx_rng_reset(DeviceState *dev)
 {
     STM32F2XXRngState *s = STM32F2XX_RNG(dev);
-    (void)s;
+
+    do {
+        qemu_guest_getrandom_nofail(&s->state, sizeof(s->state));
+    } while (s->state == 0);
 }
 
 static uint64_t stm32f2xx_rng_read(void *opaque, hwaddr addr,
@@ -50,7 +73,7 @@ static uint64_t stm32f2xx_rng_read(void *opaque, hwaddr addr,
         value = 0x1; // DRDR is always 1
         break;
     case RNG_DR:
-        qemu_guest_getrandom(&value, sizeof(value), NULL);
+        value = stm32f2xx_rng_next(s);
         break;
     default:
         qemu_log_mask(LOG_UNIMP,
@@ -105,11 +128,23 @@ static void stm32f2xx_rng_init(Object *obj)
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_rng = {
+    .name = TYPE_STM32F2XX_RNG,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(CR, STM32F2XXRngState),
+        VMSTATE_UINT64(state, STM32F2XXRngState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_rng_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = stm32f2xx_rng_reset;
+    dc->vmsd = &vmstate_stm32f2xx_rng;
 }
 
 static const TypeInfo stm32f2xx_rng_info = {
@@ -26,6 +26,7 @@
 #include "hw/misc/stm32f2xx_usb_otg_fs.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 
 static void stm32f2xx_usb_otg_fs_reset(DeviceState *dev)
@@ -93,11 +94,22 @@ static void stm32f2xx_usb_otg_fs_init(Object *obj)
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
+static const VMStateDescription vmstate_stm32f2xx_usb_otg_fs = {
+    .name = TYPE_STM32F2XX_USB_OTG_FS,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(grstctl, STM32F2XXUsbOtgFsState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void stm32f2xx_usb_otg_fs_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = stm32f2xx_usb_otg_fs_reset;
+    dc->vmsd = &vmstate_stm32f2xx_usb_otg_fs;
 }
 
 static const TypeInfo stm32f2xx_usb_otg_fs_info = {
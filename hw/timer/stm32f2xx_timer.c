@@ -272,7 +272,7 @@ static const MemoryRegionOps stm32f2xx_timer_ops = {
 
 static const VMStateDescription vmstate_stm32f2xx_timer = {
     .name = TYPE_STM32F2XX_TIMER,
-    .version_id = 1,
+    .version_id = 2,
     .minimum_version_id = 1,
     .fields = (VMStateField[]) {
         VMSTATE_INT64(tick_offset, STM32F2XXTimerState),
@@ -294,6 +294,8 @@ static const VMStateDescription vmstate_stm32f2xx_timer = {
         VMSTATE_UINT32(tim_dcr, STM32F2XXTimerState),
         VMSTATE_UINT32(tim_dmar, STM32F2XXTimerState),
         VMSTATE_UINT32(tim_or, STM32F2XXTimerState),
+        VMSTATE_UINT64_V(hit_time, STM32F2XXTimerState, 2),
+        VMSTATE_TIMER_PTR_V(timer, STM32F2XXTimerState, 2),
         VMSTATE_END_OF_LIST()
     }
 };
@@ -532,6 +532,9 @@ struct TranslationBlock {
     uintptr_t jmp_list_head;
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_dest[2];
+
+    /* Number of executions, only counted if superblocks are enabled */
+    uint32_t exec_count;
 };
 
 /* Hide the qatomic_read to make code a little easier on the eyes */
@@ -551,6 +554,18 @@ void tb_invalidate_phys_range(target_ulong start, target_ulong end);
 void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr, MemTxAttrs attrs);
 #endif
 void tb_flush(CPUState *cpu);
+#if !defined(CONFIG_USER_ONLY)
+/**
+ * tb_prefetch_add:
+ * @start: first address of a range of ROM code
+ * @end: address following the range
+ *
+ * Have TCG translate the range ahead of time, while the vCPU is halted.
+ * Ranges are translated in the order they are added.  Does nothing if
+ * TCG is not in use.
+ */
+void tb_prefetch_add(target_ulong start, target_ulong end);
+#endif
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, uint32_t flags,
@@ -133,6 +133,38 @@ void gdb_register_coprocessor(CPUState *cpu,
                               gdb_get_reg_cb get_reg, gdb_set_reg_cb set_reg,
                               int num_regs, const char *xml, int g_pos);
 
+/**
+ * GDBRegDesc: a register as described by the gdb XML of a CPU
+ * @gdb_reg: register number in the gdb remote protocol
+ * @name: register name, interned
+ * @feature_name: name of the XML feature holding the register, interned
+ */
+typedef struct GDBRegDesc {
+    int gdb_reg;
+    const char *name;
+    const char *feature_name;
+} GDBRegDesc;
+
+/**
+ * gdb_get_register_list: list the registers of a CPU
+ * @cpu: CPU
+ *
+ * Returns a #GArray of #GDBRegDesc, parsed from the core and
+ * coprocessor XML descriptions of @cpu.  The caller must free it.
+ */
+GArray *gdb_get_register_list(CPUState *cpu);
+
+/**
+ * gdb_read_register: read a register of a CPU
+ * @cpu: CPU
+ * @buf: array the value is appended to, in target byte order
+ * @reg: register number in the gdb remote protocol
+ *
+ * Returns the size of the register in bytes, or 0 if @reg does
+ * not exist.
+ */
+int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg);
+
 /*
  * The GDB remote protocol transfers values in target byte order. As
  * the gdbstub may be batching up several register values we always
@@ -69,7 +69,10 @@ static inline void fuzz_dma_read_cb(size_t addr,
 /* Dirty tracking enabled because measuring dirty rate */
 #define GLOBAL_DIRTY_DIRTY_RATE (1U << 1)
 
-#define GLOBAL_DIRTY_MASK  (0x3)
+/* Dirty tracking enabled because an in-memory checkpoint exists */
+#define GLOBAL_DIRTY_CHECKPOINT (1U << 2)
+
+#define GLOBAL_DIRTY_MASK  (0x7)
 
 extern unsigned int global_dirty_tracking;
 
@@ -1529,6 +1532,32 @@ void memory_region_init_rom(MemoryRegion *mr,
                             uint64_t size,
                             Error **errp);
 
+/**
+ * memory_region_init_rom_from_file: Initialize a ROM memory region backed
+ *                                   by a host file.
+ *
+ * Like memory_region_init_rom(), but the contents are mapped privately
+ * from @path instead of being allocated and filled by the loader.  Pages
+ * are only read from the file when the guest first touches them, and
+ * pages that are never written from the host side are shared with the
+ * other processes mapping the same file.  @path must be writable.
+ * Only available on POSIX hosts.
+ *
+ * @mr: the #MemoryRegion to be initialized.
+ * @owner: the object that tracks the region's reference count
+ * @name: Region name, becomes part of RAMBlock name used in migration stream
+ *        must be unique within any device
+ * @size: size of the region, @path must be at least that large.
+ * @path: the file holding the ROM contents.
+ * @errp: pointer to Error*, to store an error if it happens.
+ */
+void memory_region_init_rom_from_file(MemoryRegion *mr,
+                                      Object *owner,
+                                      const char *name,
+                                      uint64_t size,
+                                      const char *path,
+                                      Error **errp);
+
 /**
  * memory_region_init_rom_device:  Initialize a ROM memory region.
  *                                 Writes are handled via callbacks.
@@ -2466,6 +2495,12 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
                                          MemOp op,
                                          MemTxAttrs attrs);
 
+/**
+ * memory_mmio_profile_enabled: whether the accesses dispatched to I/O
+ * regions are being accounted (see x-mmio-profile)
+ */
+bool memory_mmio_profile_enabled(void);
+
 /**
  * address_space_init: initializes an address space
  *
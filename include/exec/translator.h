@@ -75,6 +75,13 @@ typedef struct DisasContextBase {
     int num_insns;
     int max_insns;
     bool singlestep_enabled;
+    /*
+     * Whether the TB is hot and should follow direct branches.  Code
+     * following a branch backward must set @pc_max to the end of the
+     * code translated so far, so that the TB covers all of it.
+     */
+    bool superblock;
+    target_ulong pc_max;
 #ifdef CONFIG_USER_ONLY
     /*
      * Guest address of the last byte of the last protected page.
@@ -187,6 +187,12 @@ typedef struct float_status {
     /* should denormalised inputs go to zero and set the input_denormal flag? */
     bool flush_inputs_to_zero;
     bool default_nan_mode;
+    /*
+     * Allow hardfloat even when the inexact flag is clear. The inexact
+     * flag is then not computed for those operations; the caller is
+     * responsible for recovering it from the host FPU's flags.
+     */
+    bool lazy_inexact;
     /*
      * The flags below are not used on all specializations and may
      * constant fold away (see snan_bit_is_one()/no_signalling_nans() in
@@ -52,6 +52,8 @@ OBJECT_DECLARE_SIMPLE_TYPE(ARMv7MState, ARMV7M)
  * + Property "vfp": enable VFP (forwarded to CPU object)
  * + Property "dsp": enable DSP (forwarded to CPU object)
  * + Property "enable-bitband": expose bitbanded IO
+ * + Property "inline-bitband": translate accesses to the SRAM bit-band
+ *   alias as inline accesses to the aliased RAM (requires "enable-bitband")
  * + Clock input "refclk" is the external reference clock for the systick timers
  * + Clock input "cpuclk" is the main CPU clock
  */
@@ -96,6 +98,7 @@ struct ARMv7MState {
     uint32_t init_svtor;
     uint32_t init_nsvtor;
     bool enable_bitband;
+    bool inline_bitband;
     bool start_powered_off;
     bool vfp;
     bool dsp;
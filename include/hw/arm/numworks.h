@@ -38,12 +38,26 @@ typedef struct NumworksState {
 
     MemoryRegion external_flash;
 
+    char *flash_cache;
+    char *flash_file;
+    char *external_flash_file;
+    bool hle;
+    bool tb_prefetch;
+
+    /* Execution budgets, 0 if unlimited */
+    uint64_t insn_budget;
+    uint64_t time_budget;
+    int budget_action;
+    QEMUTimer *budget_timer;
+
 } NumworksState;
 
 typedef struct NumworksClass {
     MachineClass parent;
     DeviceState* (*init)(NumworksState *s);
     int flash_size;
+    hwaddr flash_base;
+    uint64_t external_flash_size;
     const char * RowGPIO;
     const char * ColumnGPIO;
     unsigned long long int SysclkFrq;
@@ -67,6 +67,7 @@ struct STM32F4XXState {
     /*< public >*/
 
     char *soc_type;
+    char *flash_file;
 
     ARMv7MState armv7m;
 
@@ -86,6 +87,7 @@ struct STM32F4XXState {
     MemoryRegion sram;
     MemoryRegion flash;
     MemoryRegion flash_alias;
+    bool inline_bitband;
 
     Clock *sysclk;
     Clock *refclk;
@@ -82,6 +82,8 @@ struct STM32F730State {
     MemoryRegion sram;
     MemoryRegion flash;
     MemoryRegion flash_alias;
+    char *flash_file;
+    bool inline_bitband;
 
     Clock *sysclk;
     Clock *refclk;
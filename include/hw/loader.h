@@ -184,6 +184,87 @@ ssize_t load_elf(const char *filename,
  */
 void load_elf_hdr(const char *filename, void *hdr, bool *is64, Error **errp);
 
+typedef struct ElfFlatImage {
+    hwaddr base;
+    uint64_t size;
+    char *path;
+} ElfFlatImage;
+
+/** load_elf_flat_cached:
+ * @filename: Path of a 32-bit ELF file
+ * @cache_dir: Directory in which the flattened images are kept
+ * @images: Physical ranges to extract; on success the path of each
+ * raw image is stored in @images[i].path and must be freed by the caller
+ * @nb_images: Number of entries in @images
+ * @errp: Populated with an error in failure cases
+ *
+ * Flatten the loadable segments of an ELF file into one raw image of
+ * @images[i].size bytes per range, so that a ROM can be mapped straight
+ * from the host file instead of being copied at reset.  The images are
+ * named after the SHA-256 of the ELF file, so a given ELF file is only
+ * parsed the first time it is seen.  Fails if a segment does not fit in
+ * one of the ranges, in which case the caller should load the ELF file
+ * the usual way.
+ *
+ * Returns true on success.
+ */
+bool load_elf_flat_cached(const char *filename, const char *cache_dir,
+                          ElfFlatImage *images, int nb_images, Error **errp);
+
+typedef struct ElfSymbolLookup {
+    const char *name;
+    uint64_t value;
+    bool found;
+} ElfSymbolLookup;
+
+/** load_elf_lookup_symbols:
+ * @filename: Path of a 32-bit ELF file
+ * @syms: Function symbols to look up; @syms[i].found is set and
+ * @syms[i].value holds the symbol value for each symbol defined in the file
+ * @nb_syms: Number of entries in @syms
+ * @pflags: If non-NULL, populated with the ELF e_flags
+ * @errp: Populated with an error in failure cases
+ *
+ * Look up the values of a few function symbols in the symbol table of an
+ * ELF file, without loading it.  Unlike the symbols collected by
+ * load_elf_ram_sym(), this also works when the image itself is loaded
+ * from a flattened copy.
+ *
+ * Returns true on success, even if some symbols were not found.
+ */
+bool load_elf_lookup_symbols(const char *filename, ElfSymbolLookup *syms,
+                             int nb_syms, uint32_t *pflags, Error **errp);
+
+typedef void ElfFunctionFn(const char *name, uint64_t value, uint64_t size,
+                           void *opaque);
+
+/** load_elf_foreach_function:
+ * @filename: Path of a 32-bit ELF file
+ * @fn: Called for each function symbol defined in the file
+ * @opaque: Passed to @fn
+ * @pflags: If non-NULL, populated with the ELF e_flags
+ * @errp: Populated with an error in failure cases
+ *
+ * Walk the function symbols of an ELF file, without loading it.
+ *
+ * Returns true on success.
+ */
+bool load_elf_foreach_function(const char *filename, ElfFunctionFn *fn,
+                               void *opaque, uint32_t *pflags, Error **errp);
+
+/** load_elf_symbols:
+ * @filename: Path of a 32-bit ELF file
+ * @clear_lsb: Clear the bottom bit of the symbol values, which marks
+ * Thumb and MIPS16 functions
+ * @errp: Populated with an error in failure cases
+ *
+ * Add the function symbols of an ELF file to the ones lookup_symbol()
+ * searches, as load_elf() does, without loading the image.
+ *
+ * Returns true on success.
+ */
+bool load_elf_symbols(const char *filename, bool clear_lsb, Error **errp);
+
 ssize_t load_aout(const char *filename, hwaddr addr, int max_sz,
                   int bswap_needed, hwaddr target_page_size);
 
@@ -43,6 +43,7 @@ struct STM32F2XXRngState {
     MemoryRegion mmio;
 
     uint32_t CR;
+    uint64_t state;
 };
 
 #endif
@@ -61,4 +61,35 @@ bool delete_snapshot(const char *name,
                     bool has_devices, strList *devices,
                     Error **errp);
 
+typedef struct Checkpoint Checkpoint;
+
+/**
+ * checkpoint_create: Copy the VM state to host memory.
+ * @rom: whether to copy read-only memory blocks as well
+ * @errp: pointer to error object
+ * The vCPUs must not be executing.
+ * On success, return the new checkpoint.
+ * On failure, store an error through @errp and return %NULL.
+ */
+Checkpoint *checkpoint_create(bool rom, Error **errp);
+
+/**
+ * checkpoint_load: Restore the VM state from a checkpoint.
+ * @cp: checkpoint returned by checkpoint_create()
+ * @errp: pointer to error object
+ * The VM must be stopped.  Only the pages that differ from the
+ * checkpoint are copied back.
+ * On success, return %true.
+ * On failure, store an error through @errp and return %false.
+ */
+bool checkpoint_load(Checkpoint *cp, Error **errp);
+
+/**
+ * checkpoint_get_size: Host memory used by a checkpoint, in bytes.
+ * @cp: checkpoint returned by checkpoint_create()
+ */
+size_t checkpoint_get_size(const Checkpoint *cp);
+
+void checkpoint_free(Checkpoint *cp);
+
 #endif
@@ -100,6 +100,8 @@ struct qemu_plugin_dyn_cb {
     union qemu_plugin_cb_sig f;
     void *userp;
     enum plugin_dyn_cb_subtype type;
+    /* @flags applies to regular callbacks only */
+    enum qemu_plugin_cb_flags flags;
     /* @rw applies to mem callbacks only (both regular and inline) */
     enum qemu_plugin_mem_rw rw;
     /* fields specific to each dyn_cb type go here */
@@ -51,7 +51,13 @@ typedef uint64_t qemu_plugin_id_t;
 
 extern QEMU_PLUGIN_EXPORT int qemu_plugin_version;
 
-#define QEMU_PLUGIN_VERSION 1
+/*
+ * version 1: initial API
+ * version 2: added qemu_plugin_get_registers(), qemu_plugin_read_register(),
+ *            qemu_plugin_read_memory_vaddr() and
+ *            qemu_plugin_read_memory_hwaddr()
+ */
+#define QEMU_PLUGIN_VERSION 2
 
 /**
  * struct qemu_info_t - system information for plugins
@@ -218,8 +224,10 @@ struct qemu_plugin_insn;
  * @QEMU_PLUGIN_CB_R_REGS: callback reads the CPU's regs
  * @QEMU_PLUGIN_CB_RW_REGS: callback reads and writes the CPU's regs
  *
- * Note: currently unused, plugins cannot read or change system
- * register state.
+ * Callbacks registered with @QEMU_PLUGIN_CB_R_REGS or
+ * @QEMU_PLUGIN_CB_RW_REGS may read the registers of the vCPU with
+ * qemu_plugin_read_register(), at the cost of syncing them to memory
+ * before each call.  Plugins cannot change the register state.
  */
 enum qemu_plugin_cb_flags {
     QEMU_PLUGIN_CB_NO_REGS,
@@ -625,4 +633,85 @@ uint64_t qemu_plugin_end_code(void);
  */
 uint64_t qemu_plugin_entry_code(void);
 
+/*
+ * Reading the vCPU state
+ *
+ * The following functions read the state of the vCPU that is running
+ * the current callback, and may only be called from the TB translation,
+ * TB and instruction execution, memory and syscall callbacks.  In
+ * execution and memory callbacks registered with QEMU_PLUGIN_CB_R_REGS,
+ * registers written by the instructions translated before the callback
+ * are up to date, except for the program counter, which the translator
+ * only updates when leaving a TB.  Instruction callbacks should use
+ * qemu_plugin_insn_vaddr() instead.
+ */
+
+/** struct qemu_plugin_register - opaque handle for a vCPU register */
+struct qemu_plugin_register;
+
+/**
+ * typedef qemu_plugin_reg_descriptor - register description
+ * @handle: opaque handle for qemu_plugin_read_register()
+ * @name: register name, as in the gdb XML description of the vCPU
+ * @feature: name of the gdb XML feature holding the register
+ *
+ * The strings are owned by QEMU and remain valid until it exits.
+ */
+typedef struct {
+    struct qemu_plugin_register *handle;
+    const char *name;
+    const char *feature;
+} qemu_plugin_reg_descriptor;
+
+/**
+ * qemu_plugin_get_registers() - list the registers of the current vCPU
+ * @regs: array filled with the register descriptions, or NULL
+ * @max: number of entries in @regs
+ *
+ * Fills up to @max entries of @regs. Call with @regs NULL to size the
+ * array. The handles are the same for all vCPUs of the same type, so
+ * plugins usually look up the registers they need once, from their
+ * first TB translation callback.
+ *
+ * Returns: the number of registers of the vCPU
+ */
+int qemu_plugin_get_registers(qemu_plugin_reg_descriptor *regs, int max);
+
+/**
+ * qemu_plugin_read_register() - read a register of the current vCPU
+ * @handle: register handle from qemu_plugin_get_registers()
+ * @buf: buffer for the value, in target byte order
+ * @size: size of @buf
+ *
+ * Returns: the size of the register in bytes, or -1 if the register
+ * does not exist or does not fit in @buf
+ */
+int qemu_plugin_read_register(struct qemu_plugin_register *handle,
+                              void *buf, size_t size);
+
+/**
+ * qemu_plugin_read_memory_vaddr() - read guest virtual memory
+ * @addr: virtual address, translated by the current vCPU
+ * @buf: buffer for the data
+ * @len: number of bytes to read
+ *
+ * The read has no side effect on the guest, and does not raise any
+ * guest exception.
+ *
+ * Returns: true on success, false if some of the memory is unmapped
+ */
+bool qemu_plugin_read_memory_vaddr(uint64_t addr, void *buf, size_t len);
+
+/**
+ * qemu_plugin_read_memory_hwaddr() - read guest physical memory
+ * @addr: physical address, in the address space of the current vCPU
+ * @buf: buffer for the data
+ * @len: number of bytes to read
+ *
+ * Always fails for linux-user guests.
+ *
+ * Returns: true on success, false if the read failed
+ */
+bool qemu_plugin_read_memory_hwaddr(uint64_t addr, void *buf, size_t len);
+
 #endif /* QEMU_QEMU_PLUGIN_H */
@@ -0,0 +1,39 @@
+/*
+ * Startup profiling
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_STARTUP_PROFILE_H
+#define QEMU_STARTUP_PROFILE_H
+
+typedef enum StartupProfileKind {
+    STARTUP_PROFILE_REALIZE,
+    STARTUP_PROFILE_COMMIT,
+    STARTUP_PROFILE__MAX,
+} StartupProfileKind;
+
+extern bool startup_profile_enabled;
+
+/* Start the clock */
+void startup_profile_init(void);
+
+/*
+ * End the phase under way and start one called @name.  Phases are always
+ * recorded, so that the ones run before the command line is parsed are
+ * part of the report.
+ */
+void startup_profile_phase(const char *name);
+
+/*
+ * Account @ns to @name in the @kind table.  A NULL @name stands for the
+ * phase under way.  Only call this when startup_profile_enabled is set.
+ */
+void startup_profile_account(StartupProfileKind kind, const char *name,
+                             int64_t ns);
+
+/* Print the report on stderr if enabled, and stop profiling */
+void startup_profile_report(void);
+
+#endif
@@ -62,6 +62,11 @@ void qemu_system_wakeup_enable(WakeupReason reason, bool enabled);
 void qemu_register_wakeup_notifier(Notifier *notifier);
 void qemu_register_wakeup_support(void);
 void qemu_system_shutdown_request(ShutdownCause reason);
+/*
+ * Exit status of QEMU once the main loop returns, EXIT_SUCCESS unless
+ * something that the guest did not report makes the run a failure.
+ */
+void qemu_system_set_exit_status(int status);
 void qemu_system_powerdown_request(void);
 void qemu_register_powerdown_notifier(Notifier *notifier);
 void qemu_register_shutdown_notifier(Notifier *notifier);
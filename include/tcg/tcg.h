@@ -1005,6 +1005,10 @@ do {\
 bool tcg_op_supported(TCGOpcode op);
 
 void tcg_gen_callN(void *func, TCGTemp *ret, int nargs, TCGTemp **args);
+#ifdef CONFIG_PLUGIN
+/* The helper description that the call ops to @func carry */
+TCGArg tcg_helper_info_arg(void *func);
+#endif
 
 TCGOp *tcg_emit_op(TCGOpcode opc);
 void tcg_op_remove(TCGContext *s, TCGOp *op);
@@ -0,0 +1,422 @@
+/*
+ * In-memory checkpoint and fast in-place restore
+ *
+ * The guest RAM and the device state are copied to host memory once, and
+ * dirty page tracking records what the guest modifies afterwards.  A
+ * restore then only copies back the dirtied pages and reloads the device
+ * state, which is far cheaper than a system_reset followed by a full
+ * firmware boot on machines with little RAM.
+ *
+ * The same in-memory copies back the snapshot ring used for reverse
+ * debugging in replay mode, which restores them by comparing pages
+ * instead of tracking dirty memory.  Those snapshots leave read-only
+ * memory out, since nothing writes to it while a log is replayed.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-migration.h"
+#include "exec/ramblock.h"
+#include "exec/ram_addr.h"
+#include "exec/memory.h"
+#include "exec/exec-all.h"
+#include "hw/core/cpu.h"
+#include "io/channel-buffer.h"
+#include "migration/blocker.h"
+#include "migration/snapshot.h"
+#include "qemu/rcu_queue.h"
+#include "sysemu/replay.h"
+#include "sysemu/runstate.h"
+#include "sysemu/tcg.h"
+#include "qemu-file.h"
+#include "savevm.h"
+#include "ram.h"
+#include "trace.h"
+
+#define CHECKPOINT_DEVICE_BUFFER_SIZE (64 * 1024)
+
+typedef struct CheckpointBlock {
+    RAMBlock *rb;
+    ram_addr_t length;
+    uint8_t *backup;
+} CheckpointBlock;
+
+struct Checkpoint {
+    GArray *blocks;
+    uint8_t *devices;
+    size_t devices_size;
+    size_t size;
+};
+
+static Checkpoint *checkpoint;
+static Error *checkpoint_blocker;
+
+void checkpoint_free(Checkpoint *cp)
+{
+    guint i;
+
+    if (!cp) {
+        return;
+    }
+
+    for (i = 0; i < cp->blocks->len; i++) {
+        g_free(g_array_index(cp->blocks, CheckpointBlock, i).backup);
+    }
+    g_array_free(cp->blocks, true);
+    g_free(cp->devices);
+    g_free(cp);
+}
+
+size_t checkpoint_get_size(const Checkpoint *cp)
+{
+    return cp->size;
+}
+
+static void checkpoint_discard(void)
+{
+    if (!checkpoint) {
+        return;
+    }
+
+    checkpoint_free(checkpoint);
+    checkpoint = NULL;
+
+    memory_global_dirty_log_stop(GLOBAL_DIRTY_CHECKPOINT);
+    migrate_del_blocker(checkpoint_blocker);
+    error_free(checkpoint_blocker);
+    checkpoint_blocker = NULL;
+}
+
+static bool checkpoint_save_devices(Checkpoint *cp, Error **errp)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    int ret;
+
+    bioc = qio_channel_buffer_new(CHECKPOINT_DEVICE_BUFFER_SIZE);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "checkpoint-buffer");
+    f = qemu_file_new_output(QIO_CHANNEL(bioc));
+
+    ret = qemu_save_device_state(f);
+    qemu_fflush(f);
+    if (ret == 0) {
+        cp->devices_size = bioc->usage;
+        cp->devices = g_memdup2(bioc->data, bioc->usage);
+    }
+
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Failed to save device state");
+        return false;
+    }
+    return true;
+}
+
+static bool checkpoint_load_devices(Checkpoint *cp, Error **errp)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    int ret = 0;
+
+    /* Closing the channel frees its data, so hand it a private copy */
+    bioc = qio_channel_buffer_new(cp->devices_size);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "checkpoint-buffer");
+    memcpy(bioc->data, cp->devices, cp->devices_size);
+    bioc->usage = cp->devices_size;
+    f = qemu_file_new_input(QIO_CHANNEL(bioc));
+
+    if (qemu_get_be32(f) != QEMU_VM_FILE_MAGIC ||
+        qemu_get_be32(f) != QEMU_VM_FILE_VERSION) {
+        ret = -EINVAL;
+    } else {
+        ret = qemu_load_device_state(f);
+    }
+
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Failed to load device state");
+        return false;
+    }
+    return true;
+}
+
+static void checkpoint_save_ram(Checkpoint *cp, bool rom)
+{
+    RAMBlock *rb;
+
+    RCU_READ_LOCK_GUARD();
+
+    RAMBLOCK_FOREACH_MIGRATABLE(rb) {
+        CheckpointBlock cb = {
+            .rb = rb,
+            .length = rb->used_length,
+        };
+
+        if (!rom && memory_region_is_rom(rb->mr)) {
+            continue;
+        }
+
+        cb.backup = g_malloc(cb.length);
+        memcpy(cb.backup, rb->host, cb.length);
+        g_array_append_val(cp->blocks, cb);
+        cp->size += cb.length;
+
+        trace_checkpoint_save_block(rb->idstr, cb.length);
+    }
+}
+
+static void checkpoint_clear_dirty(Checkpoint *cp)
+{
+    guint i;
+
+    for (i = 0; i < cp->blocks->len; i++) {
+        CheckpointBlock *cb = &g_array_index(cp->blocks, CheckpointBlock, i);
+
+        g_free(memory_region_snapshot_and_clear_dirty(cb->rb->mr, 0,
+                                                      cb->length,
+                                                      DIRTY_MEMORY_MIGRATION));
+    }
+}
+
+/* Returns true if translation blocks had to be dropped for the page */
+static bool checkpoint_restore_page(CheckpointBlock *cb, ram_addr_t offset)
+{
+    RAMBlock *rb = cb->rb;
+    ram_addr_t len = MIN(TARGET_PAGE_SIZE, cb->length - offset);
+
+    memcpy(rb->host + offset, cb->backup + offset, len);
+
+    /*
+     * Like invalidate_and_set_dirty(), only drop the translation blocks
+     * of pages that actually hold code.  Untouched pages keep their
+     * translations.
+     */
+    if (tcg_enabled() &&
+        !cpu_physical_memory_get_dirty_flag(rb->offset + offset,
+                                            DIRTY_MEMORY_CODE)) {
+        tb_invalidate_phys_range(rb->offset + offset,
+                                 rb->offset + offset + len);
+        return true;
+    }
+    return false;
+}
+
+static void checkpoint_restore_block(CheckpointBlock *cb,
+                                     CheckpointRestoreInfo *info)
+{
+    RAMBlock *rb = cb->rb;
+    DirtyBitmapSnapshot *snap;
+    ram_addr_t offset;
+    uint64_t pages = 0;
+
+    snap = memory_region_snapshot_and_clear_dirty(rb->mr, 0, cb->length,
+                                                  DIRTY_MEMORY_MIGRATION);
+
+    for (offset = 0; offset < cb->length; offset += TARGET_PAGE_SIZE) {
+        if (!memory_region_snapshot_get_dirty(rb->mr, snap, offset,
+                                              TARGET_PAGE_SIZE)) {
+            continue;
+        }
+
+        pages++;
+        if (checkpoint_restore_page(cb, offset)) {
+            info->code_pages++;
+        }
+    }
+
+    g_free(snap);
+    info->dirty_pages += pages;
+    trace_checkpoint_restore_block(rb->idstr, pages);
+}
+
+/* Without dirty tracking, find the modified pages by comparing them */
+static void checkpoint_compare_block(CheckpointBlock *cb)
+{
+    ram_addr_t offset, len;
+    uint64_t pages = 0;
+
+    for (offset = 0; offset < cb->length; offset += TARGET_PAGE_SIZE) {
+        len = MIN(TARGET_PAGE_SIZE, cb->length - offset);
+        if (memcmp(cb->rb->host + offset, cb->backup + offset, len) == 0) {
+            continue;
+        }
+
+        pages++;
+        checkpoint_restore_page(cb, offset);
+    }
+
+    trace_checkpoint_restore_block(cb->rb->idstr, pages);
+}
+
+static bool checkpoint_check_blocks(Checkpoint *cp, Error **errp)
+{
+    guint i;
+
+    RCU_READ_LOCK_GUARD();
+
+    for (i = 0; i < cp->blocks->len; i++) {
+        CheckpointBlock *cb = &g_array_index(cp->blocks, CheckpointBlock, i);
+
+        if (qemu_ram_block_by_name(cb->rb->idstr) != cb->rb ||
+            cb->rb->used_length != cb->length) {
+            error_setg(errp, "RAM block '%s' changed since the checkpoint",
+                       cb->rb->idstr);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkpoint_flush_tlbs(void)
+{
+    CPUState *cpu;
+
+    /* MMU/MPU state came back with the CPU, cached mappings may be stale */
+    CPU_FOREACH(cpu) {
+        tlb_flush(cpu);
+    }
+}
+
+Checkpoint *checkpoint_create(bool rom, Error **errp)
+{
+    Checkpoint *cp = g_new0(Checkpoint, 1);
+
+    cp->blocks = g_array_new(false, false, sizeof(CheckpointBlock));
+    checkpoint_save_ram(cp, rom);
+
+    if (!checkpoint_save_devices(cp, errp)) {
+        checkpoint_free(cp);
+        return NULL;
+    }
+    cp->size += cp->devices_size;
+
+    return cp;
+}
+
+bool checkpoint_load(Checkpoint *cp, Error **errp)
+{
+    guint i;
+
+    if (!checkpoint_check_blocks(cp, errp)) {
+        return false;
+    }
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        for (i = 0; i < cp->blocks->len; i++) {
+            checkpoint_compare_block(&g_array_index(cp->blocks,
+                                                    CheckpointBlock, i));
+        }
+    }
+
+    if (!checkpoint_load_devices(cp, errp)) {
+        return false;
+    }
+
+    checkpoint_flush_tlbs();
+    return true;
+}
+
+void qmp_x_checkpoint_save(Error **errp)
+{
+    Checkpoint *cp;
+    bool saved_vm_running;
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "Checkpoints require the TCG accelerator");
+        return;
+    }
+    if (replay_mode != REPLAY_MODE_NONE) {
+        error_setg(errp, "Checkpoints are not supported with record/replay");
+        return;
+    }
+    if (global_dirty_tracking & ~GLOBAL_DIRTY_CHECKPOINT) {
+        error_setg(errp, "Dirty page tracking is already in use");
+        return;
+    }
+
+    checkpoint_discard();
+
+    error_setg(&checkpoint_blocker,
+               "Migration is disabled while a checkpoint exists");
+    if (migrate_add_blocker(checkpoint_blocker, errp) < 0) {
+        error_free(checkpoint_blocker);
+        checkpoint_blocker = NULL;
+        return;
+    }
+
+    saved_vm_running = runstate_is_running();
+    vm_stop(RUN_STATE_SAVE_VM);
+
+    /*
+     * Device models that update RAM through a host pointer only mark it
+     * dirty for the migration client while global dirty tracking is on.
+     */
+    memory_global_dirty_log_start(GLOBAL_DIRTY_CHECKPOINT);
+    cp = checkpoint_create(true, errp);
+    if (cp) {
+        checkpoint_clear_dirty(cp);
+        checkpoint = cp;
+    } else {
+        memory_global_dirty_log_stop(GLOBAL_DIRTY_CHECKPOINT);
+        migrate_del_blocker(checkpoint_blocker);
+        error_free(checkpoint_blocker);
+        checkpoint_blocker = NULL;
+    }
+
+    if (saved_vm_running) {
+        vm_start();
+    }
+}
+
+CheckpointRestoreInfo *qmp_x_checkpoint_restore(Error **errp)
+{
+    CheckpointRestoreInfo *info;
+    bool saved_vm_running;
+    guint i;
+
+    if (!checkpoint) {
+        error_setg(errp, "No checkpoint has been recorded");
+        return NULL;
+    }
+    if (!checkpoint_check_blocks(checkpoint, errp)) {
+        return NULL;
+    }
+
+    saved_vm_running = runstate_is_running();
+    vm_stop(RUN_STATE_RESTORE_VM);
+
+    info = g_new0(CheckpointRestoreInfo, 1);
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        for (i = 0; i < checkpoint->blocks->len; i++) {
+            checkpoint_restore_block(&g_array_index(checkpoint->blocks,
+                                                    CheckpointBlock, i),
+                                     info);
+        }
+    }
+
+    if (!checkpoint_load_devices(checkpoint, errp)) {
+        qapi_free_CheckpointRestoreInfo(info);
+        return NULL;
+    }
+
+    checkpoint_flush_tlbs();
+
+    if (saved_vm_running) {
+        vm_start();
+    }
+
+    return info;
+}
+
+void qmp_x_checkpoint_discard(Error **errp)
+{
+    checkpoint_discard();
+}
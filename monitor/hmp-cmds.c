@@ -18,6 +18,7 @@
 #include "net/net.h"
 #include "net/eth.h"
 #include "chardev/char.h"
+#include "exec/memory.h"
 #include "sysemu/block-backend.h"
 #include "sysemu/runstate.h"
 #include "qemu/config-file.h"
@@ -935,6 +936,63 @@ void hmp_sync_profile(Monitor *mon, const QDict *qdict)
     }
 }
 
+void hmp_mmio_profile(Monitor *mon, const QDict *qdict)
+{
+    const char *op = qdict_get_try_str(qdict, "op");
+    bool on = memory_mmio_profile_enabled();
+    Error *err = NULL;
+
+    if (op == NULL) {
+        monitor_printf(mon, "mmio-profile is %s\n", on ? "on" : "off");
+        return;
+    }
+    if (!strcmp(op, "on")) {
+        qmp_x_mmio_profile(true, false, false, &err);
+    } else if (!strcmp(op, "off")) {
+        qmp_x_mmio_profile(false, false, false, &err);
+    } else if (!strcmp(op, "reset")) {
+        qmp_x_mmio_profile(on, true, true, &err);
+    } else {
+        error_setg(&err, QERR_INVALID_PARAMETER, op);
+    }
+    hmp_handle_error(mon, err);
+}
+
+void hmp_info_mmio_profile(Monitor *mon, const QDict *qdict)
+{
+    int64_t max = qdict_get_try_int(qdict, "max", INT64_MAX);
+    MmioProfileEntryList *list, *l;
+    Error *err = NULL;
+
+    list = qmp_x_query_mmio_profile(&err);
+    if (hmp_handle_error(mon, err)) {
+        return;
+    }
+    if (!list) {
+        monitor_printf(mon, "No MMIO accesses recorded%s\n",
+                       memory_mmio_profile_enabled() ? "" :
+                       " (enable with 'mmio-profile on')");
+        return;
+    }
+
+    monitor_printf(mon, "%-24s %10s %10s %12s %12s %12s  %s\n",
+                   "Region", "Reads", "Writes", "Bytes", "Host ms",
+                   "ns/access", "Owner");
+    for (l = list; l && max-- > 0; l = l->next) {
+        MmioProfileEntry *e = l->value;
+        uint64_t accesses = e->reads + e->writes;
+        uint64_t ns = e->read_ns + e->write_ns;
+
+        monitor_printf(mon, "%-24s %10" PRId64 " %10" PRId64 " %12" PRId64
+                       " %12.3f %12.1f  %s\n",
+                       e->region, e->reads, e->writes,
+                       e->read_bytes + e->write_bytes, ns / 1e6,
+                       accesses ? (double)ns / accesses : 0.0,
+                       e->has_owner ? e->owner : "-");
+    }
+    qapi_free_MmioProfileEntryList(list);
+}
+
 void hmp_system_reset(Monitor *mon, const QDict *qdict)
 {
     qmp_system_reset(NULL);
@@ -41,6 +41,7 @@
 #include "exec/exec-all.h"
 #include "exec/ram_addr.h"
 #include "disas/disas.h"
+#include "exec/gdbstub.h"
 #include "plugin.h"
 #ifndef CONFIG_USER_ONLY
 #include "qemu/plugin-memory.h"
@@ -398,6 +399,60 @@ bool qemu_plugin_bool_parse(const char *name, const char *value, bool *ret)
     return name && value && qapi_bool_parse(name, value, ret, NULL);
 }
 
+/*
+ * vCPU state. The register handles are the gdb register numbers plus
+ * one, so that no handle is NULL.
+ */
+
+int qemu_plugin_get_registers(qemu_plugin_reg_descriptor *regs, int max)
+{
+    g_autoptr(GArray) list = NULL;
+    int i;
+
+    g_assert(current_cpu);
+    list = gdb_get_register_list(current_cpu);
+    for (i = 0; regs && i < max && i < list->len; i++) {
+        GDBRegDesc *desc = &g_array_index(list, GDBRegDesc, i);
+
+        regs[i].handle = GINT_TO_POINTER(desc->gdb_reg + 1);
+        regs[i].name = desc->name;
+        regs[i].feature = desc->feature_name;
+    }
+    return list->len;
+}
+
+int qemu_plugin_read_register(struct qemu_plugin_register *handle,
+                              void *buf, size_t size)
+{
+    g_autoptr(GByteArray) val = g_byte_array_new();
+    int len;
+
+    g_assert(current_cpu);
+    len = gdb_read_register(current_cpu, val, GPOINTER_TO_INT(handle) - 1);
+    if (len <= 0 || len > size) {
+        return -1;
+    }
+    memcpy(buf, val->data, len);
+    return len;
+}
+
+bool qemu_plugin_read_memory_vaddr(uint64_t addr, void *buf, size_t len)
+{
+    g_assert(current_cpu);
+    return cpu_memory_rw_debug(current_cpu, addr, buf, len, false) == 0;
+}
+
+bool qemu_plugin_read_memory_hwaddr(uint64_t addr, void *buf, size_t len)
+{
+#ifdef CONFIG_SOFTMMU
+    g_assert(current_cpu);
+    return address_space_read(current_cpu->as, addr, MEMTXATTRS_UNSPECIFIED,
+                              buf, len) == MEMTX_OK;
+#else
+    return false;
+#endif
+}
+
 /*
  * Binary path, start and end locations
  */
@@ -184,6 +184,7 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                superblock-threshold=n (executions before a TCG block is extended, default=0)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
 SRST
@@ -218,6 +219,15 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``superblock-threshold=n``
+        Counts the executions of each TCG translation block, and
+        retranslates a block as a superblock once it has run ``n`` times.
+        A superblock carries on past the direct branches of the guest
+        code, so that hot loops run without going back to the block
+        lookup. Only targets that support it extend blocks, and blocks
+        are not extended with ``-icount``. The default is 0, which
+        disables the counters.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -4319,13 +4329,13 @@ SRST
 ERST
 
 DEF("icount", HAS_ARG, QEMU_OPTION_icount, \
-    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>]]\n" \
+    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>][,rrperiod=N][,rrmem=size]]\n" \
     "                enable virtual instruction counter with 2^N clock ticks per\n" \
     "                instruction, enable aligning the host and virtual clocks\n" \
     "                or disable real time cpu sleeping, and optionally enable\n" \
     "                record-and-replay mode\n", QEMU_ARCH_ALL)
 SRST
-``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot]]``
+``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot][,rrperiod=N][,rrmem=size]]``
     Enable virtual instruction counter. The virtual cpu will execute one
     instruction every 2^N ns of virtual time. If ``auto`` is specified
     then the virtual cpu speed will be automatically adjusted to keep
@@ -4367,6 +4377,11 @@ SRST
     name. In record mode, a new VM snapshot with the given name is created
     at the start of execution recording. In replay mode this option
     specifies the snapshot name used to load the initial VM state.
+    In replay mode, ``rrperiod=N`` keeps an in-memory VM snapshot at every
+    multiple of N million instructions, so that reverse debugging does not have to
+    replay the execution from its start and works without any block
+    device. ``rrmem`` limits the host memory used by these snapshots
+    (default 256M); the oldest ones are dropped first.
 ERST
 
 DEF("watchdog", HAS_ARG, QEMU_OPTION_watchdog, \
@@ -4720,6 +4735,18 @@ SRST
     Enable synchronization profiling.
 ERST
 
+DEF("startup-profile", 0, QEMU_OPTION_startup_profile,
+    "-startup-profile\n"
+    "                print the time spent starting up on stderr\n",
+    QEMU_ARCH_ALL)
+SRST
+``-startup-profile``
+    Print on stderr, once the machine is ready to run, the time spent in
+    each phase of the startup, in the realize method of each device type
+    and in the memory transaction commits of each phase. With
+    ``-preconfig`` the report stops at the preconfig state.
+ERST
+
 DEFHEADING()
 
 DEFHEADING(Generic object creation:)
@@ -185,6 +185,7 @@ static void replay_seek(int64_t icount, QEMUTimerCB callback, Error **errp)
 {
     char *snapshot = NULL;
     int64_t snapshot_icount;
+    int64_t ring_icount;
 
     if (replay_mode != REPLAY_MODE_PLAY) {
         error_setg(errp, "replay must be enabled to seek");
@@ -192,14 +193,25 @@ static void replay_seek(int64_t icount, QEMUTimerCB callback, Error **errp)
     }
 
     snapshot = replay_find_nearest_snapshot(icount, &snapshot_icount);
-    if (snapshot) {
+    ring_icount = replay_ring_find_nearest(icount);
+    if (ring_icount != -1 && ring_icount >= snapshot_icount) {
+        /* The in-memory snapshot is closer, no need to touch the disk */
+        if (icount < replay_get_current_icount()
+            || replay_get_current_icount() < ring_icount) {
+            vm_stop(RUN_STATE_RESTORE_VM);
+            if (!replay_ring_load(ring_icount, errp)) {
+                g_free(snapshot);
+                return;
+            }
+        }
+    } else if (snapshot) {
         if (icount < replay_get_current_icount()
             || replay_get_current_icount() < snapshot_icount) {
             vm_stop(RUN_STATE_RESTORE_VM);
             load_snapshot(snapshot, NULL, false, NULL, errp);
         }
-        g_free(snapshot);
     }
+    g_free(snapshot);
     if (replay_get_current_icount() <= icount) {
         replay_break(icount, callback, NULL);
         vm_start();
@@ -324,8 +336,11 @@ void replay_gdb_attached(void)
     /*
      * Create VM snapshot on temporary overlay to allow reverse
      * debugging even if snapshots were not enabled.
+     * The in-memory snapshot ring does not need any block device.
      */
-    if (replay_mode == REPLAY_MODE_PLAY
+    if (replay_mode == REPLAY_MODE_PLAY && replay_ring_period) {
+        replay_ring_save();
+    } else if (replay_mode == REPLAY_MODE_PLAY
         && !replay_snapshot) {
         if (!save_snapshot("start_debugging", true, NULL, false, NULL, NULL)) {
             /* Can't create the snapshot. Continue conventional debugging. */
@@ -190,4 +190,28 @@ void *replay_event_net_load(void);
    to make cached timers available for post_load functions. */
 void replay_vmstate_register(void);
 
+/* In-memory snapshot ring */
+
+#define REPLAY_RING_DEFAULT_LIMIT (256 * MiB)
+
+/*! Instructions between two in-memory snapshots, 0 if disabled */
+extern uint64_t replay_ring_period;
+/*! Maximum amount of host memory used by the snapshot ring */
+extern uint64_t replay_ring_limit;
+
+/*! Frees the snapshot ring */
+void replay_ring_finish(void);
+/*! Takes an in-memory snapshot at the current instruction count.
+    The vCPU must not be executing. */
+void replay_ring_save(void);
+/*! Returns how many of @count instructions can be executed before
+    the next periodic in-memory snapshot. */
+int replay_ring_clip_instructions(int count);
+/*! Returns the instruction count of the nearest in-memory snapshot
+    at or before @icount, or -1 if there is none. */
+int64_t replay_ring_find_nearest(int64_t icount);
+/*! Restores the in-memory snapshot taken at @icount.
+    The VM must be stopped. */
+bool replay_ring_load(int64_t icount, Error **errp);
+
 #endif
@@ -18,6 +18,7 @@
 #include "qemu/error-report.h"
 #include "migration/vmstate.h"
 #include "migration/snapshot.h"
+#include "hw/core/cpu.h"
 
 static int replay_pre_save(void *opaque)
 {
@@ -96,3 +97,163 @@ bool replay_can_snapshot(void)
     return replay_mode == REPLAY_MODE_NONE
         || !replay_has_events();
 }
+
+/*
+ * In-memory snapshot ring.
+ *
+ * In replay mode an in-memory snapshot is taken every replay_ring_period
+ * instructions, so that seeking backwards only has to replay from the
+ * nearest snapshot instead of from the beginning of the log.  Machines
+ * without a block device can not store regular snapshots at all.  When the
+ * ring grows beyond replay_ring_limit bytes the oldest snapshots are
+ * dropped.
+ *
+ * The vCPU thread stops executing exactly at each multiple of the period
+ * and takes the snapshot itself, between two cpu_exec() calls.  The
+ * snapshots therefore land at the same instruction counts in every replay
+ * of a log, and the VM run state does not change while they are taken.
+ */
+
+typedef struct ReplayRingEntry {
+    int64_t icount;
+    Checkpoint *cp;
+} ReplayRingEntry;
+
+uint64_t replay_ring_period;
+uint64_t replay_ring_limit;
+
+/* Entries sorted by instruction count */
+static GQueue replay_ring = G_QUEUE_INIT;
+static size_t replay_ring_size;
+/* Instruction count of the last snapshot attempt */
+static uint64_t replay_ring_last = -1ULL;
+static bool replay_ring_pending;
+
+static void replay_ring_entry_free(ReplayRingEntry *entry)
+{
+    replay_ring_size -= checkpoint_get_size(entry->cp);
+    checkpoint_free(entry->cp);
+    g_free(entry);
+}
+
+static gint replay_ring_compare(gconstpointer a, gconstpointer b,
+                                gpointer opaque)
+{
+    const ReplayRingEntry *ea = a;
+    const ReplayRingEntry *eb = b;
+
+    return ea->icount < eb->icount ? -1 : ea->icount > eb->icount;
+}
+
+static ReplayRingEntry *replay_ring_find(int64_t icount)
+{
+    ReplayRingEntry *nearest = NULL;
+    GList *l;
+
+    for (l = replay_ring.head; l; l = l->next) {
+        ReplayRingEntry *entry = l->data;
+
+        if (entry->icount > icount) {
+            break;
+        }
+        nearest = entry;
+    }
+    return nearest;
+}
+
+void replay_ring_save(void)
+{
+    ReplayRingEntry *entry;
+    Error *err = NULL;
+    int64_t icount;
+
+    if (!replay_ring_period) {
+        return;
+    }
+
+    /* Even a skipped snapshot must let the vCPU go on */
+    icount = replay_get_current_icount();
+    replay_ring_last = icount;
+
+    if (!replay_can_snapshot()) {
+        return;
+    }
+
+    entry = replay_ring_find(icount);
+    if (entry && entry->icount == icount) {
+        return;
+    }
+
+    entry = g_new0(ReplayRingEntry, 1);
+    entry->icount = icount;
+    /* ROM is left out, the guest can not change it during the replay */
+    entry->cp = checkpoint_create(false, &err);
+    if (entry->cp) {
+        replay_ring_size += checkpoint_get_size(entry->cp);
+        g_queue_insert_sorted(&replay_ring, entry, replay_ring_compare, NULL);
+    } else {
+        error_report_err(err);
+        g_free(entry);
+    }
+
+    while (replay_ring_size > replay_ring_limit) {
+        replay_ring_entry_free(g_queue_pop_head(&replay_ring));
+    }
+}
+
+static void replay_ring_save_work(CPUState *cpu, run_on_cpu_data data)
+{
+    replay_ring_pending = false;
+    replay_ring_save();
+}
+
+int replay_ring_clip_instructions(int count)
+{
+    uint64_t current = replay_get_current_icount();
+    uint64_t next;
+
+    if (!replay_ring_period) {
+        return count;
+    }
+
+    if (current % replay_ring_period == 0 && current != replay_ring_last) {
+        /* Hold the vCPU until it has taken the snapshot */
+        if (!replay_ring_pending) {
+            replay_ring_pending = true;
+            async_run_on_cpu(first_cpu, replay_ring_save_work,
+                             RUN_ON_CPU_NULL);
+        }
+        return 0;
+    }
+
+    next = current - current % replay_ring_period + replay_ring_period;
+    return MIN(count, next - current);
+}
+
+int64_t replay_ring_find_nearest(int64_t icount)
+{
+    ReplayRingEntry *entry = replay_ring_find(icount);
+
+    return entry ? entry->icount : -1;
+}
+
+bool replay_ring_load(int64_t icount, Error **errp)
+{
+    ReplayRingEntry *entry = replay_ring_find(icount);
+
+    if (!entry || entry->icount != icount) {
+        error_setg(errp, "no in-memory snapshot at instruction %" PRId64,
+                   icount);
+        return false;
+    }
+    return checkpoint_load(entry->cp, errp);
+}
+
+void replay_ring_finish(void)
+{
+    ReplayRingEntry *entry;
+
+    while ((entry = g_queue_pop_head(&replay_ring))) {
+        replay_ring_entry_free(entry);
+    }
+}
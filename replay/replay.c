@@ -17,6 +17,7 @@
 #include "replay-internal.h"
 #include "qemu/main-loop.h"
 #include "qemu/option.h"
+#include "qemu/units.h"
 #include "sysemu/cpus.h"
 #include "qemu/error-report.h"
 
@@ -84,6 +85,7 @@ int replay_get_instructions(void)
                 res = replay_break_icount - current;
             }
         }
+        res = replay_ring_clip_instructions(res);
     }
     replay_mutex_unlock();
     return res;
@@ -312,6 +314,9 @@ void replay_configure(QemuOpts *opts)
     }
 
     replay_snapshot = g_strdup(qemu_opt_get(opts, "rrsnapshot"));
+    replay_ring_period = qemu_opt_get_number(opts, "rrperiod", 0) * 1000000;
+    replay_ring_limit = qemu_opt_get_size(opts, "rrmem",
+                                          REPLAY_RING_DEFAULT_LIMIT);
     replay_vmstate_register();
     replay_enable(fname, mode);
 
@@ -334,8 +339,6 @@ void replay_start(void)
         exit(1);
     }
 
-    /* Timer for snapshotting will be set up here. */
-
     replay_enable_events();
 }
 
@@ -373,6 +376,7 @@ void replay_finish(void)
 
     g_free(replay_snapshot);
     replay_snapshot = NULL;
+    replay_ring_finish();
 
     replay_finish_events();
     replay_mode = REPLAY_MODE_NONE;
@@ -18,10 +18,14 @@
 #include "qapi/error.h"
 #include "exec/memory.h"
 #include "qapi/visitor.h"
+#include "qapi/qapi-commands-machine.h"
 #include "qemu/bitops.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
 #include "qemu/qemu-print.h"
+#include "qemu/startup-profile.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
 #include "qom/object.h"
 #include "trace.h"
 
@@ -1095,6 +1099,8 @@ void memory_region_transaction_commit(void)
     --memory_region_transaction_depth;
     if (!memory_region_transaction_depth) {
         if (memory_region_update_pending) {
+            int64_t start = startup_profile_enabled ? get_clock() : 0;
+
             flatviews_reset();
 
             MEMORY_LISTENER_CALL_GLOBAL(begin, Forward);
@@ -1106,6 +1112,10 @@ void memory_region_transaction_commit(void)
             memory_region_update_pending = false;
             ioeventfd_update_pending = false;
             MEMORY_LISTENER_CALL_GLOBAL(commit, Forward);
+            if (start) {
+                startup_profile_account(STARTUP_PROFILE_COMMIT, NULL,
+                                        get_clock() - start);
+            }
         } else if (ioeventfd_update_pending) {
             QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
                 address_space_update_ioeventfds(as);
@@ -1412,6 +1422,116 @@ bool memory_region_access_valid(MemoryRegion *mr,
     return true;
 }
 
+/*
+ * Per-region MMIO accounting.  When disabled, the only cost on the
+ * dispatch path is the test of mmio_profile_enabled.
+ */
+typedef struct MMIOProfileStats {
+    uint64_t accesses[2];
+    uint64_t bytes[2];
+    uint64_t ns[2];
+} MMIOProfileStats;
+
+static bool mmio_profile_enabled;
+static QemuMutex mmio_profile_lock;
+static GHashTable *mmio_profile_table;
+
+/*
+ * Set up before any vCPU can see mmio_profile_enabled, so that the
+ * dispatch path never races with the creation of the lock or table.
+ */
+static void __attribute__((__constructor__)) mmio_profile_init(void)
+{
+    qemu_mutex_init(&mmio_profile_lock);
+    mmio_profile_table = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+}
+
+static void mmio_profile_account(MemoryRegion *mr, bool is_write,
+                                 unsigned size, int64_t ns)
+{
+    MMIOProfileStats *s;
+
+    qemu_mutex_lock(&mmio_profile_lock);
+    s = g_hash_table_lookup(mmio_profile_table, mr);
+    if (!s) {
+        s = g_new0(MMIOProfileStats, 1);
+        g_hash_table_insert(mmio_profile_table, mr, s);
+    }
+    s->accesses[is_write]++;
+    s->bytes[is_write] += size;
+    s->ns[is_write] += ns;
+    qemu_mutex_unlock(&mmio_profile_lock);
+}
+
+static void mmio_profile_forget(MemoryRegion *mr)
+{
+    qemu_mutex_lock(&mmio_profile_lock);
+    g_hash_table_remove(mmio_profile_table, mr);
+    qemu_mutex_unlock(&mmio_profile_lock);
+}
+
+bool memory_mmio_profile_enabled(void)
+{
+    return qatomic_read(&mmio_profile_enabled);
+}
+
+void qmp_x_mmio_profile(bool enable, bool has_reset, bool reset,
+                        Error **errp)
+{
+    if (has_reset && reset) {
+        qemu_mutex_lock(&mmio_profile_lock);
+        g_hash_table_remove_all(mmio_profile_table);
+        qemu_mutex_unlock(&mmio_profile_lock);
+    }
+    qatomic_set(&mmio_profile_enabled, enable);
+}
+
+static gint mmio_profile_cmp(gconstpointer a, gconstpointer b)
+{
+    const MmioProfileEntry *ea = *(MmioProfileEntry * const *)a;
+    const MmioProfileEntry *eb = *(MmioProfileEntry * const *)b;
+    uint64_t ta = ea->read_ns + ea->write_ns;
+    uint64_t tb = eb->read_ns + eb->write_ns;
+
+    return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+MmioProfileEntryList *qmp_x_query_mmio_profile(Error **errp)
+{
+    MmioProfileEntryList *head = NULL;
+    g_autoptr(GPtrArray) entries = g_ptr_array_new();
+    GHashTableIter iter;
+    MemoryRegion *mr;
+    MMIOProfileStats *s;
+    int i;
+
+    qemu_mutex_lock(&mmio_profile_lock);
+    g_hash_table_iter_init(&iter, mmio_profile_table);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&mr, (gpointer *)&s)) {
+        MmioProfileEntry *e = g_new0(MmioProfileEntry, 1);
+
+        e->region = g_strdup(memory_region_name(mr));
+        if (mr->owner) {
+            e->has_owner = true;
+            e->owner = object_get_canonical_path(mr->owner);
+        }
+        e->reads = s->accesses[0];
+        e->writes = s->accesses[1];
+        e->read_bytes = s->bytes[0];
+        e->write_bytes = s->bytes[1];
+        e->read_ns = s->ns[0];
+        e->write_ns = s->ns[1];
+        g_ptr_array_add(entries, e);
+    }
+    qemu_mutex_unlock(&mmio_profile_lock);
+
+    g_ptr_array_sort(entries, mmio_profile_cmp);
+    for (i = entries->len - 1; i >= 0; i--) {
+        QAPI_LIST_PREPEND(head, g_ptr_array_index(entries, i));
+    }
+    return head;
+}
+
 static MemTxResult memory_region_dispatch_read1(MemoryRegion *mr,
                                                 hwaddr addr,
                                                 uint64_t *pval,
@@ -1454,7 +1574,14 @@ MemTxResult memory_region_dispatch_read(MemoryRegion *mr,
         return MEMTX_DECODE_ERROR;
     }
 
-    r = memory_region_dispatch_read1(mr, addr, pval, size, attrs);
+    if (unlikely(qatomic_read(&mmio_profile_enabled))) {
+        int64_t start = get_clock();
+
+        r = memory_region_dispatch_read1(mr, addr, pval, size, attrs);
+        mmio_profile_account(mr, false, size, get_clock() - start);
+    } else {
+        r = memory_region_dispatch_read1(mr, addr, pval, size, attrs);
+    }
     adjust_endianness(mr, pval, op);
     return r;
 }
@@ -1485,6 +1612,28 @@ static bool memory_region_dispatch_write_eventfds(MemoryRegion *mr,
     return false;
 }
 
+static MemTxResult memory_region_dispatch_write1(MemoryRegion *mr,
+                                                 hwaddr addr,
+                                                 uint64_t data,
+                                                 unsigned size,
+                                                 MemTxAttrs attrs)
+{
+    if (mr->ops->write) {
+        return access_with_adjusted_size(addr, &data, size,
+                                         mr->ops->impl.min_access_size,
+                                         mr->ops->impl.max_access_size,
+                                         memory_region_write_accessor, mr,
+                                         attrs);
+    } else {
+        return
+            access_with_adjusted_size(addr, &data, size,
+                                      mr->ops->impl.min_access_size,
+                                      mr->ops->impl.max_access_size,
+                                      memory_region_write_with_attrs_accessor,
+                                      mr, attrs);
+    }
+}
+
 MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
                                          hwaddr addr,
                                          uint64_t data,
@@ -1492,6 +1641,7 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
                                          MemTxAttrs attrs)
 {
     unsigned size = memop_size(op);
+    MemTxResult r;
 
     if (mr->alias) {
         return memory_region_dispatch_write(mr->alias,
@@ -1510,20 +1660,14 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
         return MEMTX_OK;
     }
 
-    if (mr->ops->write) {
-        return access_with_adjusted_size(addr, &data, size,
-                                         mr->ops->impl.min_access_size,
-                                         mr->ops->impl.max_access_size,
-                                         memory_region_write_accessor, mr,
-                                         attrs);
-    } else {
-        return
-            access_with_adjusted_size(addr, &data, size,
-                                      mr->ops->impl.min_access_size,
-                                      mr->ops->impl.max_access_size,
-                                      memory_region_write_with_attrs_accessor,
-                                      mr, attrs);
+    if (unlikely(qatomic_read(&mmio_profile_enabled))) {
+        int64_t start = get_clock();
+
+        r = memory_region_dispatch_write1(mr, addr, data, size, attrs);
+        mmio_profile_account(mr, true, size, get_clock() - start);
+        return r;
     }
+    return memory_region_dispatch_write1(mr, addr, data, size, attrs);
 }
 
 void memory_region_init_io(MemoryRegion *mr,
@@ -1764,6 +1908,7 @@ static void memory_region_finalize(Object *obj)
     memory_region_transaction_commit();
 
     mr->destructor(mr);
+    mmio_profile_forget(mr);
     memory_region_clear_coalescing(mr);
     g_free((char *)mr->name);
     g_free(mr->ioeventfds);
@@ -3502,6 +3647,39 @@ void memory_region_init_rom(MemoryRegion *mr,
     vmstate_register_ram(mr, owner_dev);
 }
 
+void memory_region_init_rom_from_file(MemoryRegion *mr,
+                                      Object *owner,
+                                      const char *name,
+                                      uint64_t size,
+                                      const char *path,
+                                      Error **errp)
+{
+#ifdef CONFIG_POSIX
+    DeviceState *owner_dev;
+    Error *err = NULL;
+
+    /*
+     * Map the file privately but writable, and only make the region
+     * read-only for the guest.  Debugger writes and the loader then get a
+     * private copy of the page instead of faulting, while every page that
+     * is never written stays shared through the page cache with all the
+     * processes mapping the same file.
+     */
+    memory_region_init_ram_from_file(mr, owner, name, size, 0, 0, path,
+                                     false, &err);
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    mr->readonly = true;
+    /* See memory_region_init_rom() about the owner */
+    owner_dev = DEVICE(owner);
+    vmstate_register_ram(mr, owner_dev);
+#else
+    error_setg(errp, "Mapping ROM from a file is not supported on this host");
+#endif
+}
+
 void memory_region_init_rom_device(MemoryRegion *mr,
                                    Object *owner,
                                    const MemoryRegionOps *ops,
@@ -104,6 +104,7 @@
 #include "trace/control.h"
 #include "qemu/plugin.h"
 #include "qemu/queue.h"
+#include "qemu/startup-profile.h"
 #include "sysemu/arch_init.h"
 #include "exec/confidential-guest-support.h"
 
@@ -447,6 +448,12 @@ static QemuOptsList qemu_icount_opts = {
         }, {
             .name = "rrsnapshot",
             .type = QEMU_OPT_STRING,
+        }, {
+            .name = "rrperiod",
+            .type = QEMU_OPT_NUMBER,
+        }, {
+            .name = "rrmem",
+            .type = QEMU_OPT_SIZE,
         },
         { /* end of list */ }
     },
@@ -2586,8 +2593,11 @@ void qmp_x_exit_preconfig(Error **errp)
         return;
     }
 
+    startup_profile_phase("board-init");
     qemu_init_board();
+    startup_profile_phase("cli-devices");
     qemu_create_cli_devices();
+    startup_profile_phase("machine-done");
     qemu_machine_creation_done();
 
     if (loadvm) {
@@ -2622,6 +2632,8 @@ void qemu_init(int argc, char **argv, char **envp)
     bool userconfig = true;
     FILE *vmstate_dump_file = NULL;
 
+    startup_profile_init();
+    startup_profile_phase("init-subsystems");
     qemu_add_opts(&qemu_drive_opts);
     qemu_add_drive_opts(&qemu_legacy_drive_opts);
     qemu_add_drive_opts(&qemu_common_drive_opts);
@@ -2662,6 +2674,8 @@ void qemu_init(int argc, char **argv, char **envp)
 
     qemu_init_subsystems();
 
+    startup_profile_phase("parse-options");
+
     /* first pass of option parsing */
     optind = 1;
     while (optind < argc) {
@@ -3465,6 +3479,9 @@ void qemu_init(int argc, char **argv, char **envp)
             case QEMU_OPTION_enable_sync_profile:
                 qsp_enable();
                 break;
+            case QEMU_OPTION_startup_profile:
+                startup_profile_enabled = true;
+                break;
             case QEMU_OPTION_nouserconfig:
                 /* Nothing to be parsed here. Especially, do not error out below. */
                 break;
@@ -3502,6 +3519,7 @@ void qemu_init(int argc, char **argv, char **envp)
      * writeout thread to finish, which will not occur, and the parent
      * process will be left in the host.
      */
+    startup_profile_phase("main-loop");
     if (!trace_init_backends()) {
         exit(1);
     }
@@ -3515,10 +3533,12 @@ void qemu_init(int argc, char **argv, char **envp)
 
     configure_rtc(qemu_find_opts_singleton("rtc"));
 
+    startup_profile_phase("create-machine");
     qemu_create_machine(machine_opts_dict);
 
     suspend_mux_open();
 
+    startup_profile_phase("early-backends");
     qemu_disable_default_devices();
     qemu_create_default_devices();
     qemu_create_early_backends();
@@ -3532,6 +3552,7 @@ void qemu_init(int argc, char **argv, char **envp)
      * Note: uses machine properties such as kernel-irqchip, must run
      * after qemu_apply_machine_options.
      */
+    startup_profile_phase("accelerator");
     configure_accelerators(argv[0]);
     phase_advance(PHASE_ACCEL_CREATED);
 
@@ -3561,6 +3582,7 @@ void qemu_init(int argc, char **argv, char **envp)
      * Note: creates a QOM object, must run only after global and
      * compat properties have been set up.
      */
+    startup_profile_phase("late-backends");
     migration_object_init();
 
     qemu_create_late_backends();
@@ -3585,8 +3607,10 @@ void qemu_init(int argc, char **argv, char **envp)
     if (!preconfig_requested) {
         qmp_x_exit_preconfig(&error_fatal);
     }
+    startup_profile_phase("displays");
     qemu_init_displays();
     accel_setup_post(current_machine);
     os_setup_post();
     resume_mux_open();
+    startup_profile_report();
 }
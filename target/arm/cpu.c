@@ -445,6 +445,7 @@ static void arm_cpu_reset(DeviceState *dev)
                        sizeof(*env->pmsav7.drsr) * cpu->pmsav7_dregion);
                 memset(env->pmsav7.dracr, 0,
                        sizeof(*env->pmsav7.dracr) * cpu->pmsav7_dregion);
+                env->pmsav7.map_valid = false;
             }
         }
         env->pmsav7.rnr[M_REG_NS] = 0;
@@ -1207,6 +1208,9 @@ static Property arm_cpu_cfgend_property =
 static Property arm_cpu_has_vfp_property =
             DEFINE_PROP_BOOL("vfp", ARMCPU, has_vfp, true);
 
+static Property arm_cpu_lazy_fp_flags_property =
+            DEFINE_PROP_BOOL("x-lazy-fp-flags", ARMCPU, lazy_fp_flags, false);
+
 static Property arm_cpu_has_neon_property =
             DEFINE_PROP_BOOL("neon", ARMCPU, has_neon, true);
 
@@ -1335,6 +1339,8 @@ void arm_cpu_post_init(Object *obj)
         cpu->has_vfp = true;
         if (!kvm_enabled()) {
             qdev_property_add_static(DEVICE(obj), &arm_cpu_has_vfp_property);
+            qdev_property_add_static(DEVICE(obj),
+                                     &arm_cpu_lazy_fp_flags_property);
         }
     }
 
@@ -1967,6 +1973,14 @@ static void arm_cpu_realizefn(DeviceState *dev, Error **errp)
                 env->pmsav7.dracr = g_new0(uint32_t, nr);
             }
         }
+        if (!arm_feature(env, ARM_FEATURE_V8)) {
+            /*
+             * Each region contributes at most 9 boundaries (its base,
+             * subregion edges and end), plus 0 and the M profile
+             * system region.
+             */
+            env->pmsav7.map = g_new0(ARMPMSAv7MapEntry, nr * 9 + 2);
+        }
     }
 
     if (arm_feature(env, ARM_FEATURE_M_SECURITY)) {
@@ -2128,6 +2142,8 @@ static const struct TCGCPUOps arm_tcg_ops = {
     .initialize = arm_translate_init,
     .synchronize_from_tb = arm_cpu_synchronize_from_tb,
     .debug_excp_handler = arm_debug_excp_handler,
+    .cpu_exec_enter = arm_cpu_exec_enter,
+    .cpu_exec_exit = arm_cpu_exec_exit,
 
 #ifdef CONFIG_USER_ONLY
     .record_sigsegv = arm_cpu_record_sigsegv,
@@ -225,6 +225,17 @@ typedef struct ARMPACKey {
 } ARMPACKey;
 #endif
 
+/*
+ * One interval of the flattened PMSAv7 region map: the addresses from
+ * @start up to the start of the next entry all get the same result from
+ * the MPU lookup. See pmsav7_update_map().
+ */
+typedef struct ARMPMSAv7MapEntry {
+    uint32_t start;
+    bool hit;          /* false if no region matches */
+    uint8_t prot[2];   /* PAGE_* bits for privileged [0] and user [1] */
+} ARMPMSAv7MapEntry;
+
 /* See the commentary above the TBFLAG field definitions.  */
 typedef struct CPUARMTBFlags {
     uint32_t flags;
@@ -735,6 +746,14 @@ typedef struct CPUArchState {
         uint32_t *drsr;
         uint32_t *dracr;
         uint32_t rnr[M_REG_NUM_BANKS];
+        /*
+         * Sorted interval table built from the registers above on the
+         * first lookup after a change; anything writing drbar, drsr or
+         * dracr must clear map_valid.
+         */
+        ARMPMSAv7MapEntry *map;
+        uint32_t map_len;
+        bool map_valid;
     } pmsav7;
 
     /* PMSAv8 MPU */
@@ -902,6 +921,15 @@ struct ArchCPU {
     bool has_neon;
     /* CPU has M-profile DSP extension */
     bool has_dsp;
+    /* Take FPSCR.IXC from the host FPU so that hardfloat is always usable */
+    bool lazy_fp_flags;
+
+    /* Functions emulated in host code by entry point, see hle.c */
+    GHashTable *hle_funcs;
+    /* The emulated functions use the VFP procedure call standard */
+    bool hle_hard_float;
+    /* Translate accesses to the SRAM bit-band alias inline */
+    bool inline_bitband;
 
     /* CPU has memory protection unit */
     bool has_mpu;
@@ -1086,6 +1114,36 @@ void arm_cpu_do_interrupt(CPUState *cpu);
 void arm_v7m_cpu_do_interrupt(CPUState *cpu);
 #endif /* !CONFIG_USER_ONLY */
 
+/**
+ * arm_hle_name:
+ * @index: index in the list of functions that can be emulated
+ *
+ * Returns the symbol name of the @index-th run-time library function
+ * that arm_hle_register() knows about, or NULL past the end of the list.
+ */
+const char *arm_hle_name(int index);
+
+/**
+ * arm_hle_register:
+ * @cpu: CPU whose translator should emulate the function
+ * @name: symbol name of the function
+ * @addr: entry point of the function
+ * @hard_float: whether the guest uses the VFP variant of the procedure
+ * call standard, which libm functions use to pass doubles
+ *
+ * Make TBs starting at @addr call a host implementation of @name and
+ * return to the caller. This must be done before any code at @addr is
+ * translated. Returns false if @name cannot be emulated.
+ */
+bool arm_hle_register(ARMCPU *cpu, const char *name, uint32_t addr,
+                      bool hard_float);
+
+/* Returns the index of the function emulated at @addr, or -1 */
+int arm_hle_lookup(ARMCPU *cpu, uint32_t addr);
+
+/* Returns true if the @index-th emulated function accesses VFP registers */
+bool arm_hle_uses_vfp(ARMCPU *cpu, int index);
+
 hwaddr arm_cpu_get_phys_page_attrs_debug(CPUState *cpu, vaddr addr,
                                          MemTxAttrs *attrs);
 
@@ -3511,6 +3511,7 @@ static void pmsav7_write(CPUARMState *env, const ARMCPRegInfo *ri,
     u32p += env->pmsav7.rnr[M_REG_NS];
     tlb_flush(CPU(cpu)); /* Mappings may have changed - purge! */
     *u32p = value;
+    env->pmsav7.map_valid = false;
 }
 
 static void pmsav7_rgnr_write(CPUARMState *env, const ARMCPRegInfo *ri,
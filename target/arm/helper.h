@@ -75,6 +75,10 @@ DEF_HELPER_1(v7m_preserve_fp_state, void, env)
 DEF_HELPER_2(v7m_vlstm, void, env, i32)
 DEF_HELPER_2(v7m_vlldm, void, env, i32)
 
+DEF_HELPER_1(v7m_exception_return, void, env)
+
+DEF_HELPER_2(hle_call, i32, env, i32)
+
 DEF_HELPER_2(v8m_stackcheck, void, env, i32)
 
 DEF_HELPER_FLAGS_2(check_bxj_trap, TCG_CALL_NO_WG, void, env, i32)
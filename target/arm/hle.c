@@ -0,0 +1,608 @@
+/*
+ * High-level emulation of AEABI run-time library functions
+ *
+ * Cores with no or a single precision only FPU do all their double
+ * precision arithmetic through the soft-float routines of the AEABI
+ * run-time library (__aeabi_dadd and friends), each call costing hundreds
+ * of emulated instructions.  A board that knows where these routines are
+ * in the guest firmware can register them here: the translator then
+ * replaces their code with a call to a host implementation, followed by
+ * a return through LR.
+ *
+ * The host implementations use softfloat with a private float_status, so
+ * the results are the correctly rounded IEEE results the library routines
+ * compute (round to nearest even, no flush to zero) and the guest FPSCR is
+ * never touched.  Only functions whose result IEEE 754 fully specifies are
+ * handled.  Which NaN comes out, and the out of range conversions, follow
+ * the libgcc routines rather than the VFP rules; the libm functions return
+ * their NaN argument quieted, as fdlibm does.
+ *
+ * The memcpy family is done with bulk accesses to the address space.  The
+ * whole range is checked against the MPU and must be RAM or ROM before
+ * anything is touched: otherwise the guest code runs as usual, so that
+ * faults and MMIO side effects happen exactly as they would without HLE.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+#include "internals.h"
+#include "exec/helper-proto.h"
+#include "exec/memory.h"
+#include "fpu/softfloat.h"
+
+typedef void ARMHLEFn(CPUARMState *env, float_status *s);
+/* Returns false if the guest code must run instead */
+typedef bool ARMHLETryFn(CPUARMState *env);
+
+typedef struct ARMHLEFunc {
+    const char *name;
+    ARMHLEFn *fn;
+    ARMHLETryFn *try_fn;
+    /* Takes and returns doubles in d0 with the VFP procedure call standard */
+    bool libm;
+} ARMHLEFunc;
+
+/* Doubles are passed in core register pairs, low word first */
+static float64 hle_arg_d(CPUARMState *env, int n)
+{
+    return make_float64(deposit64(env->regs[2 * n], 32, 32,
+                                  env->regs[2 * n + 1]));
+}
+
+static void hle_ret_d(CPUARMState *env, float64 r)
+{
+    env->regs[0] = extract64(float64_val(r), 0, 32);
+    env->regs[1] = extract64(float64_val(r), 32, 32);
+}
+
+static uint64_t hle_arg_64(CPUARMState *env)
+{
+    return deposit64(env->regs[0], 32, 32, env->regs[1]);
+}
+
+static void hle_ret_64(CPUARMState *env, uint64_t r)
+{
+    env->regs[0] = extract64(r, 0, 32);
+    env->regs[1] = extract64(r, 32, 32);
+}
+
+/* The libm functions take and return doubles in d0 with the VFP ABI */
+static float64 hle_libm_arg(CPUARMState *env)
+{
+    if (env_archcpu(env)->hle_hard_float) {
+        return make_float64(*aa32_vfp_dreg(env, 0));
+    }
+    return hle_arg_d(env, 0);
+}
+
+static void hle_libm_ret(CPUARMState *env, float64 r)
+{
+    if (env_archcpu(env)->hle_hard_float) {
+        *aa32_vfp_dreg(env, 0) = float64_val(r);
+    } else {
+        hle_ret_d(env, r);
+    }
+}
+
+/*
+ * libgcc returns NaNs by setting the exponent and the quiet bit of one of
+ * the operands: a NaN operand keeps its sign and payload, an infinity or
+ * a zero turns into the default NaN with its sign.
+ */
+static float64 hle_quiet(float64 a)
+{
+    return make_float64(float64_val(a) | 0x7ff8000000000000ULL);
+}
+
+static bool hle_inf_or_nan(float64 a)
+{
+    return extract64(float64_val(a), 52, 11) == 0x7ff;
+}
+
+/* The first operand that is infinite or NaN gives the NaN */
+static float64 hle_add(float64 a, float64 b, float_status *s)
+{
+    float64 r = float64_add(a, b, s);
+
+    if (float64_is_any_nan(r)) {
+        return hle_quiet(hle_inf_or_nan(a) ? a : b);
+    }
+    return r;
+}
+
+/* Subtraction negates an operand, NaN included, and adds */
+static void hle_dadd(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, hle_add(hle_arg_d(env, 0), hle_arg_d(env, 1), s));
+}
+
+static void hle_dsub(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, hle_add(hle_arg_d(env, 0),
+                           float64_chs(hle_arg_d(env, 1)), s));
+}
+
+static void hle_drsub(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, hle_add(float64_chs(hle_arg_d(env, 0)),
+                           hle_arg_d(env, 1), s));
+}
+
+/* A zero times an infinity or a NaN gives the other operand */
+static void hle_dmul(CPUARMState *env, float_status *s)
+{
+    float64 a = hle_arg_d(env, 0);
+    float64 b = hle_arg_d(env, 1);
+    float64 r = float64_mul(a, b, s);
+
+    if (float64_is_any_nan(r)) {
+        if (float64_is_zero(a)) {
+            r = hle_quiet(b);
+        } else if (float64_is_zero(b) || float64_is_any_nan(a)) {
+            r = hle_quiet(a);
+        } else {
+            r = hle_quiet(b);
+        }
+    }
+    hle_ret_d(env, r);
+}
+
+/* The dividend gives the NaN, unless only the divisor is infinite or NaN */
+static void hle_ddiv(CPUARMState *env, float_status *s)
+{
+    float64 a = hle_arg_d(env, 0);
+    float64 b = hle_arg_d(env, 1);
+    float64 r = float64_div(a, b, s);
+
+    if (float64_is_any_nan(r)) {
+        r = hle_quiet(!hle_inf_or_nan(a) && hle_inf_or_nan(b) ? b : a);
+    }
+    hle_ret_d(env, r);
+}
+
+static FloatRelation hle_dcmp(CPUARMState *env, float_status *s)
+{
+    return float64_compare_quiet(hle_arg_d(env, 0), hle_arg_d(env, 1), s);
+}
+
+static void hle_dcmpeq(CPUARMState *env, float_status *s)
+{
+    env->regs[0] = hle_dcmp(env, s) == float_relation_equal;
+}
+
+static void hle_dcmplt(CPUARMState *env, float_status *s)
+{
+    env->regs[0] = hle_dcmp(env, s) == float_relation_less;
+}
+
+static void hle_dcmple(CPUARMState *env, float_status *s)
+{
+    FloatRelation r = hle_dcmp(env, s);
+
+    env->regs[0] = r == float_relation_less || r == float_relation_equal;
+}
+
+static void hle_dcmpge(CPUARMState *env, float_status *s)
+{
+    FloatRelation r = hle_dcmp(env, s);
+
+    env->regs[0] = r == float_relation_greater || r == float_relation_equal;
+}
+
+static void hle_dcmpgt(CPUARMState *env, float_status *s)
+{
+    env->regs[0] = hle_dcmp(env, s) == float_relation_greater;
+}
+
+static void hle_dcmpun(CPUARMState *env, float_status *s)
+{
+    env->regs[0] = hle_dcmp(env, s) == float_relation_unordered;
+}
+
+/*
+ * The flag-returning comparisons set NZCV from a CMP of the -1, 0 or 1
+ * that __cmpdf2 returns, with C cleared for "less than".  Unordered
+ * operands return 1, like "greater than".
+ */
+static void hle_set_nzcv(CPUARMState *env, FloatRelation r)
+{
+    static const uint32_t nzcv[] = {
+        [float_relation_less + 1] = 0x8,
+        [float_relation_equal + 1] = 0x6,
+        [float_relation_greater + 1] = 0x2,
+        [float_relation_unordered + 1] = 0x2,
+    };
+
+    cpsr_write(env, nzcv[r + 1] << 28, CPSR_NZCV, CPSRWriteRaw);
+}
+
+static void hle_cdcmple(CPUARMState *env, float_status *s)
+{
+    hle_set_nzcv(env, hle_dcmp(env, s));
+}
+
+static void hle_cdrcmple(CPUARMState *env, float_status *s)
+{
+    hle_set_nzcv(env, float64_compare_quiet(hle_arg_d(env, 1),
+                                            hle_arg_d(env, 0), s));
+}
+
+static void hle_i2d(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, int32_to_float64(env->regs[0], s));
+}
+
+static void hle_ui2d(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, uint32_to_float64(env->regs[0], s));
+}
+
+static void hle_l2d(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, int64_to_float64(hle_arg_64(env), s));
+}
+
+static void hle_ul2d(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, uint64_to_float64(hle_arg_64(env), s));
+}
+
+/* NaNs convert to 0 and out of range values saturate */
+static uint32_t hle_to_uint32(float64 a, float_status *s)
+{
+    return float64_is_any_nan(a) ? 0 : float64_to_uint32_round_to_zero(a, s);
+}
+
+static void hle_d2iz(CPUARMState *env, float_status *s)
+{
+    float64 a = hle_arg_d(env, 0);
+
+    env->regs[0] = float64_is_any_nan(a) ? 0 :
+        float64_to_int32_round_to_zero(a, s);
+}
+
+static void hle_d2uiz(CPUARMState *env, float_status *s)
+{
+    env->regs[0] = hle_to_uint32(hle_arg_d(env, 0), s);
+}
+
+/*
+ * libgcc2 converts the two halves with __aeabi_d2uiz, so that values out
+ * of the 64-bit range saturate each half separately, and the signed
+ * conversion negates the unsigned one.
+ */
+static uint64_t hle_to_uint64(float64 a, float_status *s)
+{
+    float64 w = make_float64(0x41f0000000000000ULL); /* 2^32 */
+    uint32_t hi = hle_to_uint32(float64_div(a, w, s), s);
+    float64 l = float64_sub(a, float64_mul(uint32_to_float64(hi, s), w, s),
+                            s);
+
+    return deposit64(hle_to_uint32(l, s), 32, 32, hi);
+}
+
+static void hle_d2lz(CPUARMState *env, float_status *s)
+{
+    float64 a = hle_arg_d(env, 0);
+
+    if (float64_lt_quiet(a, float64_zero, s)) {
+        hle_ret_64(env, -hle_to_uint64(float64_chs(a), s));
+    } else {
+        hle_ret_64(env, hle_to_uint64(a, s));
+    }
+}
+
+static void hle_d2ulz(CPUARMState *env, float_status *s)
+{
+    hle_ret_64(env, hle_to_uint64(hle_arg_d(env, 0), s));
+}
+
+static void hle_f2d(CPUARMState *env, float_status *s)
+{
+    hle_ret_d(env, float32_to_float64(make_float32(env->regs[0]), s));
+}
+
+/* Unlike the widening, the narrowing drops the sign and payload of NaNs */
+static void hle_d2f(CPUARMState *env, float_status *s)
+{
+    float64 a = hle_arg_d(env, 0);
+
+    env->regs[0] = float64_is_any_nan(a) ? 0x7fc00000 :
+        float32_val(float64_to_float32(a, s));
+}
+
+static void hle_sqrt(CPUARMState *env, float_status *s)
+{
+    hle_libm_ret(env, float64_sqrt(hle_libm_arg(env), s));
+}
+
+static void hle_round(CPUARMState *env, float_status *s, FloatRoundMode mode)
+{
+    set_float_rounding_mode(mode, s);
+    hle_libm_ret(env, float64_round_to_int(hle_libm_arg(env), s));
+}
+
+static void hle_floor(CPUARMState *env, float_status *s)
+{
+    hle_round(env, s, float_round_down);
+}
+
+static void hle_ceil(CPUARMState *env, float_status *s)
+{
+    hle_round(env, s, float_round_up);
+}
+
+static void hle_trunc(CPUARMState *env, float_status *s)
+{
+    hle_round(env, s, float_round_to_zero);
+}
+
+#ifndef CONFIG_USER_ONLY
+/*
+ * Access [addr, addr + len), which must be within a page, as the guest
+ * would.  Only checks that this is possible if @buf is NULL.
+ */
+static bool hle_mem_page(CPUARMState *env, uint32_t addr, uint32_t len,
+                         bool is_write, void *buf)
+{
+    CPUState *cs = env_cpu(env);
+    MemTxAttrs attrs = {};
+    target_ulong page_size;
+    hwaddr physaddr, xlat, l = len;
+    MemoryRegion *mr;
+    AddressSpace *as;
+    int prot;
+    ARMMMUFaultInfo fi = {};
+    ARMCacheAttrs cacheattrs = {};
+
+    if (get_phys_addr(env, addr, is_write ? MMU_DATA_STORE : MMU_DATA_LOAD,
+                      arm_mmu_idx(env), &physaddr, &attrs, &prot, &page_size,
+                      &fi, &cacheattrs)) {
+        return false;
+    }
+    /* The MPU region may end within the page */
+    if (page_size < TARGET_PAGE_SIZE) {
+        return false;
+    }
+
+    as = arm_addressspace(cs, attrs);
+    RCU_READ_LOCK_GUARD();
+    mr = address_space_translate(as, physaddr, &xlat, &l, is_write, attrs);
+    if (!memory_region_is_ram(mr) || (is_write && mr->readonly) || l < len) {
+        return false;
+    }
+    if (buf) {
+        address_space_rw(as, physaddr, attrs, buf, len, is_write);
+    }
+    return true;
+}
+
+static bool hle_mem_check(CPUARMState *env, uint32_t addr, uint32_t len,
+                          bool is_write)
+{
+    CPUState *cs = env_cpu(env);
+    uint32_t l;
+
+    /* Watchpoints need the guest accesses */
+    if ((uint64_t)addr + len > 1ULL << 32 ||
+        !QTAILQ_EMPTY(&cs->watchpoints)) {
+        return false;
+    }
+    while (len) {
+        l = MIN(len, TARGET_PAGE_SIZE - (addr & ~TARGET_PAGE_MASK));
+        if (!hle_mem_page(env, addr, l, is_write, NULL)) {
+            return false;
+        }
+        addr += l;
+        len -= l;
+    }
+    return true;
+}
+
+static bool hle_copy(CPUARMState *env, uint32_t dst, uint32_t src,
+                     uint32_t n)
+{
+    uint8_t buf[4096];
+    bool backward = dst > src && dst - src < n;
+    uint32_t l;
+
+    if (!hle_mem_check(env, src, n, false) ||
+        !hle_mem_check(env, dst, n, true)) {
+        return false;
+    }
+    /* Like memmove, copy backward if the destination overlaps the end */
+    while (n) {
+        l = MIN(n, sizeof(buf));
+        if (backward) {
+            l = MIN(l, ((src + n - 1) & ~TARGET_PAGE_MASK) + 1);
+            l = MIN(l, ((dst + n - 1) & ~TARGET_PAGE_MASK) + 1);
+            hle_mem_page(env, src + n - l, l, false, buf);
+            hle_mem_page(env, dst + n - l, l, true, buf);
+        } else {
+            l = MIN(l, TARGET_PAGE_SIZE - (src & ~TARGET_PAGE_MASK));
+            l = MIN(l, TARGET_PAGE_SIZE - (dst & ~TARGET_PAGE_MASK));
+            hle_mem_page(env, src, l, false, buf);
+            hle_mem_page(env, dst, l, true, buf);
+            src += l;
+            dst += l;
+        }
+        n -= l;
+    }
+    return true;
+}
+
+static bool hle_fill(CPUARMState *env, uint32_t dst, uint8_t c, uint32_t n)
+{
+    uint8_t buf[4096];
+    uint32_t l;
+
+    if (!hle_mem_check(env, dst, n, true)) {
+        return false;
+    }
+    memset(buf, c, MIN(n, sizeof(buf)));
+    while (n) {
+        l = MIN(n, sizeof(buf));
+        l = MIN(l, TARGET_PAGE_SIZE - (dst & ~TARGET_PAGE_MASK));
+        hle_mem_page(env, dst, l, true, buf);
+        dst += l;
+        n -= l;
+    }
+    return true;
+}
+#else
+static bool hle_copy(CPUARMState *env, uint32_t dst, uint32_t src,
+                     uint32_t n)
+{
+    return false;
+}
+
+static bool hle_fill(CPUARMState *env, uint32_t dst, uint8_t c, uint32_t n)
+{
+    return false;
+}
+#endif
+
+/* memcpy and memmove return dst, which is still in r0 */
+static bool hle_memmove(CPUARMState *env)
+{
+    return hle_copy(env, env->regs[0], env->regs[1], env->regs[2]);
+}
+
+static bool hle_memset(CPUARMState *env)
+{
+    return hle_fill(env, env->regs[0], env->regs[1], env->regs[2]);
+}
+
+/* Unlike memset, __aeabi_memset takes the length before the value */
+static bool hle_aeabi_memset(CPUARMState *env)
+{
+    return hle_fill(env, env->regs[0], env->regs[2], env->regs[1]);
+}
+
+static bool hle_aeabi_memclr(CPUARMState *env)
+{
+    return hle_fill(env, env->regs[0], 0, env->regs[1]);
+}
+
+static const ARMHLEFunc arm_hle_funcs[] = {
+    { "__aeabi_dadd", hle_dadd },
+    { "__adddf3", hle_dadd },
+    { "__aeabi_dsub", hle_dsub },
+    { "__subdf3", hle_dsub },
+    { "__aeabi_drsub", hle_drsub },
+    { "__aeabi_dmul", hle_dmul },
+    { "__muldf3", hle_dmul },
+    { "__aeabi_ddiv", hle_ddiv },
+    { "__divdf3", hle_ddiv },
+    { "__aeabi_dcmpeq", hle_dcmpeq },
+    { "__aeabi_dcmplt", hle_dcmplt },
+    { "__aeabi_dcmple", hle_dcmple },
+    { "__aeabi_dcmpge", hle_dcmpge },
+    { "__aeabi_dcmpgt", hle_dcmpgt },
+    { "__aeabi_dcmpun", hle_dcmpun },
+    { "__aeabi_cdcmpeq", hle_cdcmple },
+    { "__aeabi_cdcmple", hle_cdcmple },
+    { "__aeabi_cdrcmple", hle_cdrcmple },
+    { "__aeabi_i2d", hle_i2d },
+    { "__floatsidf", hle_i2d },
+    { "__aeabi_ui2d", hle_ui2d },
+    { "__floatunsidf", hle_ui2d },
+    { "__aeabi_l2d", hle_l2d },
+    { "__floatdidf", hle_l2d },
+    { "__aeabi_ul2d", hle_ul2d },
+    { "__floatundidf", hle_ul2d },
+    { "__aeabi_d2iz", hle_d2iz },
+    { "__fixdfsi", hle_d2iz },
+    { "__aeabi_d2uiz", hle_d2uiz },
+    { "__fixunsdfsi", hle_d2uiz },
+    { "__aeabi_d2lz", hle_d2lz },
+    { "__fixdfdi", hle_d2lz },
+    { "__aeabi_d2ulz", hle_d2ulz },
+    { "__fixunsdfdi", hle_d2ulz },
+    { "__aeabi_f2d", hle_f2d },
+    { "__extendsfdf2", hle_f2d },
+    { "__aeabi_d2f", hle_d2f },
+    { "__truncdfsf2", hle_d2f },
+    { "sqrt", hle_sqrt, .libm = true },
+    { "floor", hle_floor, .libm = true },
+    { "ceil", hle_ceil, .libm = true },
+    { "trunc", hle_trunc, .libm = true },
+    { "memcpy", .try_fn = hle_memmove },
+    { "memmove", .try_fn = hle_memmove },
+    { "memset", .try_fn = hle_memset },
+    { "__aeabi_memcpy", .try_fn = hle_memmove },
+    { "__aeabi_memcpy4", .try_fn = hle_memmove },
+    { "__aeabi_memcpy8", .try_fn = hle_memmove },
+    { "__aeabi_memmove", .try_fn = hle_memmove },
+    { "__aeabi_memmove4", .try_fn = hle_memmove },
+    { "__aeabi_memmove8", .try_fn = hle_memmove },
+    { "__aeabi_memset", .try_fn = hle_aeabi_memset },
+    { "__aeabi_memset4", .try_fn = hle_aeabi_memset },
+    { "__aeabi_memset8", .try_fn = hle_aeabi_memset },
+    { "__aeabi_memclr", .try_fn = hle_aeabi_memclr },
+    { "__aeabi_memclr4", .try_fn = hle_aeabi_memclr },
+    { "__aeabi_memclr8", .try_fn = hle_aeabi_memclr },
+};
+
+const char *arm_hle_name(int index)
+{
+    if (index < 0 || index >= ARRAY_SIZE(arm_hle_funcs)) {
+        return NULL;
+    }
+    return arm_hle_funcs[index].name;
+}
+
+bool arm_hle_register(ARMCPU *cpu, const char *name, uint32_t addr,
+                      bool hard_float)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(arm_hle_funcs); i++) {
+        if (!strcmp(arm_hle_funcs[i].name, name)) {
+            break;
+        }
+    }
+    if (i == ARRAY_SIZE(arm_hle_funcs)) {
+        return false;
+    }
+
+    if (!cpu->hle_funcs) {
+        cpu->hle_funcs = g_hash_table_new(NULL, NULL);
+    }
+    cpu->hle_hard_float = hard_float;
+    /* Entry points are halfword aligned, drop the Thumb bit */
+    g_hash_table_insert(cpu->hle_funcs, GUINT_TO_POINTER(addr & ~1),
+                        GINT_TO_POINTER(i + 1));
+    return true;
+}
+
+int arm_hle_lookup(ARMCPU *cpu, uint32_t addr)
+{
+    if (!cpu->hle_funcs) {
+        return -1;
+    }
+    return GPOINTER_TO_INT(g_hash_table_lookup(cpu->hle_funcs,
+                                               GUINT_TO_POINTER(addr))) - 1;
+}
+
+bool arm_hle_uses_vfp(ARMCPU *cpu, int index)
+{
+    return cpu->hle_hard_float && arm_hle_funcs[index].libm;
+}
+
+uint32_t HELPER(hle_call)(CPUARMState *env, uint32_t index)
+{
+    float_status s = {
+        .float_rounding_mode = float_round_nearest_even,
+        .tininess_before_rounding = true,
+    };
+
+    if (arm_hle_funcs[index].try_fn) {
+        return arm_hle_funcs[index].try_fn(env);
+    }
+    arm_hle_funcs[index].fn(env, &s);
+    return true;
+}
@@ -187,6 +187,8 @@ void arm_translate_init(void);
 
 #ifdef CONFIG_TCG
 void arm_cpu_synchronize_from_tb(CPUState *cs, const TranslationBlock *tb);
+void arm_cpu_exec_enter(CPUState *cs);
+void arm_cpu_exec_exit(CPUState *cs);
 #endif /* CONFIG_TCG */
 
 enum arm_fprounding {
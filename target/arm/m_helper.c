@@ -143,6 +143,12 @@ void HELPER(v7m_vlldm)(CPUARMState *env, uint32_t fptr)
     g_assert_not_reached();
 }
 
+void HELPER(v7m_exception_return)(CPUARMState *env)
+{
+    /* translate.c should never generate calls here in user-only mode */
+    g_assert_not_reached();
+}
+
 uint32_t HELPER(v7m_tt)(CPUARMState *env, uint32_t addr, uint32_t op)
 {
     /*
@@ -271,6 +277,65 @@ pend_fault:
     return false;
 }
 
+/*
+ * Stack or unstack the basic 8 word frame with a single MPU lookup and a
+ * single memory access, when it lies within one page of RAM. This is the
+ * common case for every exception entry and return, and is much cheaper
+ * than going through the MPU and the memory API once per word.
+ * Returns false without touching anything if the frame does not qualify;
+ * the caller then uses the word by word path, which also takes care of
+ * raising the right fault.
+ */
+static bool v7m_stack_frame_access(ARMCPU *cpu, uint32_t addr,
+                                   uint32_t *frame, int words,
+                                   ARMMMUIdx mmu_idx, bool is_write)
+{
+    CPUState *cs = CPU(cpu);
+    CPUARMState *env = &cpu->env;
+    MemTxAttrs attrs = {};
+    target_ulong page_size;
+    hwaddr physaddr, xlat, len = words * 4;
+    MemoryRegion *mr;
+    AddressSpace *as;
+    int prot, i;
+    ARMMMUFaultInfo fi = {};
+    ARMCacheAttrs cacheattrs = {};
+
+    if ((addr & TARGET_PAGE_MASK) != ((addr + len - 1) & TARGET_PAGE_MASK)) {
+        return false;
+    }
+    if (get_phys_addr(env, addr, is_write ? MMU_DATA_STORE : MMU_DATA_LOAD,
+                      mmu_idx, &physaddr, &attrs, &prot, &page_size,
+                      &fi, &cacheattrs)) {
+        return false;
+    }
+    /* A smaller page size means the MPU region is smaller than a page */
+    if (page_size < TARGET_PAGE_SIZE) {
+        return false;
+    }
+
+    as = arm_addressspace(cs, attrs);
+    RCU_READ_LOCK_GUARD();
+    mr = address_space_translate(as, physaddr, &xlat, &len, is_write, attrs);
+    if (!memory_region_is_ram(mr) || (is_write && mr->readonly) ||
+        len < words * 4) {
+        return false;
+    }
+
+    if (is_write) {
+        for (i = 0; i < words; i++) {
+            frame[i] = cpu_to_le32(frame[i]);
+        }
+        address_space_write(as, physaddr, attrs, frame, words * 4);
+    } else {
+        address_space_read(as, physaddr, attrs, frame, words * 4);
+        for (i = 0; i < words; i++) {
+            frame[i] = le32_to_cpu(frame[i]);
+        }
+    }
+    return true;
+}
+
 static bool v7m_stack_read(ARMCPU *cpu, uint32_t *dest, uint32_t addr,
                            ARMMMUIdx mmu_idx)
 {
@@ -1194,7 +1259,7 @@ static bool v7m_push_stack(ARMCPU *cpu)
      * should ignore further stack faults trying to process
      * that derived exception.)
      */
-    bool stacked_ok = true, limitviol = false;
+    bool stacked_ok = true, limitviol = false, fast_stacked = false;
     CPUARMState *env = &cpu->env;
     uint32_t xpsr = xpsr_read(env);
     uint32_t frameptr = env->regs[13];
@@ -1256,13 +1321,23 @@ static bool v7m_push_stack(ARMCPU *cpu)
         }
     }
 
+    if (stacked_ok) {
+        uint32_t frame[8] = {
+            env->regs[0], env->regs[1], env->regs[2], env->regs[3],
+            env->regs[12], env->regs[14], env->regs[15], xpsr,
+        };
+
+        fast_stacked = v7m_stack_frame_access(cpu, frameptr, frame, 8,
+                                              mmu_idx, true);
+    }
+
     /*
      * Write as much of the stack frame as we can. If we fail a stack
      * write this will result in a derived exception being pended
      * (which may be taken in preference to the one we started with
      * if it has higher priority).
      */
-    stacked_ok = stacked_ok &&
+    stacked_ok = stacked_ok && (fast_stacked ||
         v7m_stack_write(cpu, frameptr, env->regs[0], mmu_idx, STACK_NORMAL) &&
         v7m_stack_write(cpu, frameptr + 4, env->regs[1],
                         mmu_idx, STACK_NORMAL) &&
@@ -1276,7 +1351,7 @@ static bool v7m_push_stack(ARMCPU *cpu)
                         mmu_idx, STACK_NORMAL) &&
         v7m_stack_write(cpu, frameptr + 24, env->regs[15],
                         mmu_idx, STACK_NORMAL) &&
-        v7m_stack_write(cpu, frameptr + 28, xpsr, mmu_idx, STACK_NORMAL);
+        v7m_stack_write(cpu, frameptr + 28, xpsr, mmu_idx, STACK_NORMAL));
 
     if (env->v7m.control[M_REG_S] & R_V7M_CONTROL_FPCA_MASK) {
         /* FPU is active, try to save its registers */
@@ -1641,6 +1716,7 @@ static void do_v7m_exception_exit(ARMCPU *cpu)
                                               !return_to_handler,
                                               spsel);
         uint32_t frameptr = *frame_sp_p;
+        uint32_t frame[8];
         bool pop_ok = true;
         ARMMMUIdx mmu_idx;
         bool return_to_priv = return_to_handler ||
@@ -1689,15 +1765,27 @@ static void do_v7m_exception_exit(ARMCPU *cpu)
         }
 
         /* Pop registers */
-        pop_ok = pop_ok &&
-            v7m_stack_read(cpu, &env->regs[0], frameptr, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[1], frameptr + 0x4, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[2], frameptr + 0x8, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[3], frameptr + 0xc, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[12], frameptr + 0x10, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[14], frameptr + 0x14, mmu_idx) &&
-            v7m_stack_read(cpu, &env->regs[15], frameptr + 0x18, mmu_idx) &&
-            v7m_stack_read(cpu, &xpsr, frameptr + 0x1c, mmu_idx);
+        if (pop_ok && v7m_stack_frame_access(cpu, frameptr, frame, 8,
+                                             mmu_idx, false)) {
+            env->regs[0] = frame[0];
+            env->regs[1] = frame[1];
+            env->regs[2] = frame[2];
+            env->regs[3] = frame[3];
+            env->regs[12] = frame[4];
+            env->regs[14] = frame[5];
+            env->regs[15] = frame[6];
+            xpsr = frame[7];
+        } else {
+            pop_ok = pop_ok &&
+                v7m_stack_read(cpu, &env->regs[0], frameptr, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[1], frameptr + 0x4, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[2], frameptr + 0x8, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[3], frameptr + 0xc, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[12], frameptr + 0x10, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[14], frameptr + 0x14, mmu_idx) &&
+                v7m_stack_read(cpu, &env->regs[15], frameptr + 0x18, mmu_idx) &&
+                v7m_stack_read(cpu, &xpsr, frameptr + 0x1c, mmu_idx);
+        }
 
         if (!pop_ok) {
             /*
@@ -1915,6 +2003,22 @@ static void do_v7m_exception_exit(ARMCPU *cpu)
     qemu_log_mask(CPU_LOG_INT, "...successful exception return\n");
 }
 
+void HELPER(v7m_exception_return)(CPUARMState *env)
+{
+    /*
+     * Exception return for cores without the Security Extension, called
+     * directly from generated code rather than by raising
+     * EXCP_EXCEPTION_EXIT and going back through the main loop.
+     * The NVIC is updated as part of the return, so this must run
+     * with the iothread lock held just as do_interrupt does. Any
+     * interrupt that becomes pending as a result has been signalled
+     * with cpu_interrupt() and will be taken at the next TB boundary.
+     */
+    qemu_mutex_lock_iothread();
+    do_v7m_exception_exit(env_archcpu(env));
+    qemu_mutex_unlock_iothread();
+}
+
 static bool do_v7m_function_return(ARMCPU *cpu)
 {
     /*
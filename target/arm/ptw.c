@@ -1523,6 +1523,206 @@ static bool pmsav7_use_background_region(ARMCPU *cpu, ARMMMUIdx mmu_idx,
     }
 }
 
+/*
+ * Decode DRSR/DRBAR of region @n; returns false (logging any guest error)
+ * if the region is disabled or cannot match any address.
+ */
+static bool pmsav7_region_decode(CPUARMState *env, int n,
+                                 uint32_t *base, uint32_t *rsize)
+{
+    uint32_t rmask;
+
+    if (!(env->pmsav7.drsr[n] & 0x1)) {
+        return false;
+    }
+
+    *rsize = extract32(env->pmsav7.drsr[n], 1, 5);
+    if (!*rsize) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "DRSR[%d]: Rsize field cannot be 0\n", n);
+        return false;
+    }
+    (*rsize)++;
+    rmask = (1ull << *rsize) - 1;
+
+    *base = env->pmsav7.drbar[n];
+    if (*base & rmask) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "DRBAR[%d]: 0x%" PRIx32 " misaligned "
+                      "to DRSR region size, mask = 0x%" PRIx32 "\n",
+                      n, *base, rmask);
+        return false;
+    }
+    return true;
+}
+
+/* Return the region matching @address, or -1 for no hits */
+static int pmsav7_region_lookup(ARMCPU *cpu, uint32_t address)
+{
+    CPUARMState *env = &cpu->env;
+    uint32_t base, rsize;
+    int n;
+
+    for (n = (int)cpu->pmsav7_dregion - 1; n >= 0; n--) {
+        /* region search */
+        if (!pmsav7_region_decode(env, n, &base, &rsize)) {
+            continue;
+        }
+        if (address < base || address - base > (1ull << rsize) - 1) {
+            continue;
+        }
+        if (rsize >= 8) { /* no subregions for regions < 256 bytes */
+            int snd = ((address - base) >> (rsize - 3)) & 0x7;
+
+            if (extract32(env->pmsav7.drsr[n], snd + 8, 1)) {
+                continue;
+            }
+        }
+        return n;
+    }
+    return -1;
+}
+
+static int pmsav7_ap_to_prot(CPUARMState *env, int n, bool is_user)
+{
+    uint32_t ap = extract32(env->pmsav7.dracr[n], 8, 3);
+    int prot = 0;
+
+    if (is_user) { /* User mode AP bit decoding */
+        switch (ap) {
+        case 0:
+        case 1:
+        case 5:
+            break; /* no access */
+        case 3:
+            prot |= PAGE_WRITE;
+            /* fall through */
+        case 2:
+        case 6:
+            prot |= PAGE_READ | PAGE_EXEC;
+            break;
+        case 7:
+            /* for v7M, same as 6; for R profile a reserved value */
+            if (arm_feature(env, ARM_FEATURE_M)) {
+                prot |= PAGE_READ | PAGE_EXEC;
+                break;
+            }
+            /* fall through */
+        default:
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "DRACR[%d]: Bad value for AP bits: 0x%"
+                          PRIx32 "\n", n, ap);
+        }
+    } else { /* Priv. mode AP bits decoding */
+        switch (ap) {
+        case 0:
+            break; /* no access */
+        case 1:
+        case 2:
+        case 3:
+            prot |= PAGE_WRITE;
+            /* fall through */
+        case 5:
+        case 6:
+            prot |= PAGE_READ | PAGE_EXEC;
+            break;
+        case 7:
+            /* for v7M, same as 6; for R profile a reserved value */
+            if (arm_feature(env, ARM_FEATURE_M)) {
+                prot |= PAGE_READ | PAGE_EXEC;
+                break;
+            }
+            /* fall through */
+        default:
+            qemu_log_mask(LOG_GUEST_ERROR,
+                          "DRACR[%d]: Bad value for AP bits: 0x%"
+                          PRIx32 "\n", n, ap);
+        }
+    }
+
+    /* execute never */
+    if (extract32(env->pmsav7.dracr[n], 12, 1)) {
+        prot &= ~PAGE_EXEC;
+    }
+    return prot;
+}
+
+static int pmsav7_map_cmp(const void *a, const void *b)
+{
+    const ARMPMSAv7MapEntry *ea = a, *eb = b;
+
+    return ea->start < eb->start ? -1 : ea->start > eb->start;
+}
+
+/*
+ * Flatten the MPU regions into a sorted table of intervals over which the
+ * result of the region search is constant, so that a lookup is a binary
+ * search rather than a scan of every region with its subregions.
+ * The boundaries of the intervals are the region bases and ends, the
+ * subregion edges and, for M profile, the start of the system region
+ * (which is always execute never). Adjacent intervals with the same
+ * result are merged, which also tells get_phys_addr_pmsav7() whether a
+ * whole page translates the same way.
+ */
+static void pmsav7_update_map(ARMCPU *cpu)
+{
+    CPUARMState *env = &cpu->env;
+    ARMPMSAv7MapEntry *map = env->pmsav7.map;
+    uint32_t base, rsize, prev = 0;
+    int i, n, len = 0, out = 0;
+
+    map[len++].start = 0;
+    if (arm_feature(env, ARM_FEATURE_M)) {
+        map[len++].start = 0xe0000000;
+    }
+    for (n = 0; n < cpu->pmsav7_dregion; n++) {
+        if (!pmsav7_region_decode(env, n, &base, &rsize)) {
+            continue;
+        }
+        map[len++].start = base;
+        if (rsize >= 8) {
+            for (i = 1; i < 8; i++) {
+                map[len++].start = base + ((uint32_t)i << (rsize - 3));
+            }
+        }
+        if ((uint64_t)base + (1ull << rsize) <= UINT32_MAX) {
+            map[len++].start = base + (1ull << rsize);
+        }
+    }
+    qsort(map, len, sizeof(*map), pmsav7_map_cmp);
+
+    /* Entries are only ever written at or before the one being read */
+    for (i = 0; i < len; i++) {
+        ARMPMSAv7MapEntry e = { .start = map[i].start };
+
+        if (i > 0 && e.start == prev) {
+            continue;
+        }
+        prev = e.start;
+
+        n = pmsav7_region_lookup(cpu, e.start);
+        if (n >= 0) {
+            e.hit = true;
+            e.prot[0] = pmsav7_ap_to_prot(env, n, false);
+            e.prot[1] = pmsav7_ap_to_prot(env, n, true);
+            if (m_is_system_region(env, e.start)) {
+                /* System space is always execute never */
+                e.prot[0] &= ~PAGE_EXEC;
+                e.prot[1] &= ~PAGE_EXEC;
+            }
+        }
+        if (out > 0 && map[out - 1].hit == e.hit &&
+            map[out - 1].prot[0] == e.prot[0] &&
+            map[out - 1].prot[1] == e.prot[1]) {
+            continue;
+        }
+        map[out++] = e;
+    }
+
+    env->pmsav7.map_len = out;
+    env->pmsav7.map_valid = true;
+}
+
 static bool get_phys_addr_pmsav7(CPUARMState *env, uint32_t address,
                                  MMUAccessType access_type, ARMMMUIdx mmu_idx,
                                  hwaddr *phys_ptr, int *prot,
@@ -1530,7 +1730,6 @@ static bool get_phys_addr_pmsav7(CPUARMState *env, uint32_t address,
                                  ARMMMUFaultInfo *fi)
 {
     ARMCPU *cpu = env_archcpu(env);
-    int n;
     bool is_user = regime_is_user(env, mmu_idx);
 
     *phys_ptr = address;
@@ -1549,90 +1748,43 @@ static bool get_phys_addr_pmsav7(CPUARMState *env, uint32_t address,
          */
         get_phys_addr_pmsav7_default(env, mmu_idx, address, prot);
     } else { /* MPU enabled */
-        for (n = (int)cpu->pmsav7_dregion - 1; n >= 0; n--) {
-            /* region search */
-            uint32_t base = env->pmsav7.drbar[n];
-            uint32_t rsize = extract32(env->pmsav7.drsr[n], 1, 5);
-            uint32_t rmask;
-            bool srdis = false;
+        const ARMPMSAv7MapEntry *map, *e;
+        uint32_t lo = 0, hi, end;
 
-            if (!(env->pmsav7.drsr[n] & 0x1)) {
-                continue;
-            }
+        if (!env->pmsav7.map_valid) {
+            pmsav7_update_map(cpu);
+        }
+        map = env->pmsav7.map;
+        hi = env->pmsav7.map_len - 1;
 
-            if (!rsize) {
-                qemu_log_mask(LOG_GUEST_ERROR,
-                              "DRSR[%d]: Rsize field cannot be 0\n", n);
-                continue;
-            }
-            rsize++;
-            rmask = (1ull << rsize) - 1;
-
-            if (base & rmask) {
-                qemu_log_mask(LOG_GUEST_ERROR,
-                              "DRBAR[%d]: 0x%" PRIx32 " misaligned "
-                              "to DRSR region size, mask = 0x%" PRIx32 "\n",
-                              n, base, rmask);
-                continue;
-            }
+        /* Find the last interval starting at or before address */
+        while (lo < hi) {
+            uint32_t mid = (lo + hi + 1) / 2;
 
-            if (address < base || address > base + rmask) {
-                /*
-                 * Address not in this region. We must check whether the
-                 * region covers addresses in the same page as our address.
-                 * In that case we must not report a size that covers the
-                 * whole page for a subsequent hit against a different MPU
-                 * region or the background region, because it would result in
-                 * incorrect TLB hits for subsequent accesses to addresses that
-                 * are in this MPU region.
-                 */
-                if (ranges_overlap(base, rmask,
-                                   address & TARGET_PAGE_MASK,
-                                   TARGET_PAGE_SIZE)) {
-                    *page_size = 1;
-                }
-                continue;
+            if (map[mid].start <= address) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
             }
+        }
+        e = &map[lo];
+        end = lo + 1 < env->pmsav7.map_len ? map[lo + 1].start - 1
+                                            : UINT32_MAX;
 
-            /* Region matched */
-
-            if (rsize >= 8) { /* no subregions for regions < 256 bytes */
-                int i, snd;
-                uint32_t srdis_mask;
-
-                rsize -= 3; /* sub region size (power of 2) */
-                snd = ((address - base) >> rsize) & 0x7;
-                srdis = extract32(env->pmsav7.drsr[n], snd + 8, 1);
-
-                srdis_mask = srdis ? 0x3 : 0x0;
-                for (i = 2; i <= 8 && rsize < TARGET_PAGE_BITS; i *= 2) {
-                    /*
-                     * This will check in groups of 2, 4 and then 8, whether
-                     * the subregion bits are consistent. rsize is incremented
-                     * back up to give the region size, considering consistent
-                     * adjacent subregions as one region. Stop testing if rsize
-                     * is already big enough for an entire QEMU page.
-                     */
-                    int snd_rounded = snd & ~(i - 1);
-                    uint32_t srdis_multi = extract32(env->pmsav7.drsr[n],
-                                                     snd_rounded + 8, i);
-                    if (srdis_mask ^ srdis_multi) {
-                        break;
-                    }
-                    srdis_mask = (srdis_mask << i) | srdis_mask;
-                    rsize++;
-                }
-            }
-            if (srdis) {
-                continue;
-            }
-            if (rsize < TARGET_PAGE_BITS) {
-                *page_size = 1 << rsize;
-            }
-            break;
+        /*
+         * If the interval does not cover the whole page, other addresses
+         * in the page may translate differently, so we must not report a
+         * size that lets the TLB cache this result for all of them.
+         * The interval may well be larger than a page, but the TLB only
+         * ever holds page sized entries, and reporting a larger size would
+         * just make it treat the range as a large page on flushes.
+         */
+        if ((address & TARGET_PAGE_MASK) < e->start ||
+            (address | ~TARGET_PAGE_MASK) > end) {
+            *page_size = 1;
         }
 
-        if (n == -1) { /* no hits */
+        if (!e->hit) { /* no hits */
             if (!pmsav7_use_background_region(cpu, mmu_idx, is_user)) {
                 /* background fault */
                 fi->type = ARMFault_Background;
@@ -1640,70 +1792,7 @@ static bool get_phys_addr_pmsav7(CPUARMState *env, uint32_t address,
             }
             get_phys_addr_pmsav7_default(env, mmu_idx, address, prot);
         } else { /* a MPU hit! */
-            uint32_t ap = extract32(env->pmsav7.dracr[n], 8, 3);
-            uint32_t xn = extract32(env->pmsav7.dracr[n], 12, 1);
-
-            if (m_is_system_region(env, address)) {
-                /* System space is always execute never */
-                xn = 1;
-            }
-
-            if (is_user) { /* User mode AP bit decoding */
-                switch (ap) {
-                case 0:
-                case 1:
-                case 5:
-                    break; /* no access */
-                case 3:
-                    *prot |= PAGE_WRITE;
-                    /* fall through */
-                case 2:
-                case 6:
-                    *prot |= PAGE_READ | PAGE_EXEC;
-                    break;
-                case 7:
-                    /* for v7M, same as 6; for R profile a reserved value */
-                    if (arm_feature(env, ARM_FEATURE_M)) {
-                        *prot |= PAGE_READ | PAGE_EXEC;
-                        break;
-                    }
-                    /* fall through */
-                default:
-                    qemu_log_mask(LOG_GUEST_ERROR,
-                                  "DRACR[%d]: Bad value for AP bits: 0x%"
-                                  PRIx32 "\n", n, ap);
-                }
-            } else { /* Priv. mode AP bits decoding */
-                switch (ap) {
-                case 0:
-                    break; /* no access */
-                case 1:
-                case 2:
-                case 3:
-                    *prot |= PAGE_WRITE;
-                    /* fall through */
-                case 5:
-                case 6:
-                    *prot |= PAGE_READ | PAGE_EXEC;
-                    break;
-                case 7:
-                    /* for v7M, same as 6; for R profile a reserved value */
-                    if (arm_feature(env, ARM_FEATURE_M)) {
-                        *prot |= PAGE_READ | PAGE_EXEC;
-                        break;
-                    }
-                    /* fall through */
-                default:
-                    qemu_log_mask(LOG_GUEST_ERROR,
-                                  "DRACR[%d]: Bad value for AP bits: 0x%"
-                                  PRIx32 "\n", n, ap);
-                }
-            }
-
-            /* execute never */
-            if (xn) {
-                *prot &= ~PAGE_EXEC;
-            }
+            *prot = e->prot[is_user];
         }
     }
 
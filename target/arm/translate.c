@@ -842,22 +842,37 @@ static inline void gen_bx_excret_final_code(DisasContext *s)
     if (s->ss_active) {
         gen_singlestep_exception(s);
     } else {
-        tcg_gen_exit_tb(NULL, 0);
+        tcg_gen_lookup_and_goto_ptr();
     }
     gen_set_label(excret_label);
     /* Yes: this is an exception return.
      * At this point in runtime env->regs[15] and env->thumb will hold
      * the exception-return magic number, which do_v7m_exception_exit()
      * will read. Nothing else will be able to see those values because
-     * the cpu-exec main loop guarantees that we will always go straight
-     * from raising the exception to the exception-handling code.
+     * we either call the exception return code directly or the cpu-exec
+     * main loop guarantees that we will always go straight from raising
+     * the exception to the exception-handling code.
      *
      * gen_ss_advance(s) does nothing on M profile currently but
      * calling it is conceptually the right thing as we have executed
      * this instruction (compare SWI, HVC, SMC handling).
      */
     gen_ss_advance(s);
-    gen_exception_internal(EXCP_EXCEPTION_EXIT);
+    if (arm_dc_feature(s, ARM_FEATURE_M_SECURITY) || s->ss_active) {
+        /* FNC_RETURN handling can still raise exceptions, take the slow path */
+        gen_exception_internal(EXCP_EXCEPTION_EXIT);
+        return;
+    }
+    /*
+     * Plain exception return: do it inline and carry on with the TB
+     * for the return address without going back to the main loop.
+     * The helper talks to the NVIC, so it counts as I/O for icount.
+     */
+    if (tb_cflags(s->base.tb) & CF_USE_ICOUNT) {
+        gen_io_start();
+    }
+    gen_helper_v7m_exception_return(cpu_env);
+    tcg_gen_lookup_and_goto_ptr();
 }
 
 static inline void gen_bxns(DisasContext *s, int rm)
@@ -2610,6 +2625,56 @@ static void gen_goto_tb(DisasContext *s, int n, target_ulong dest)
     s->base.is_jmp = DISAS_NORETURN;
 }
 
+#define SB_MAX_FOLLOWED 8
+
+/*
+ * In a superblock, carry on translating at the likely successor of a
+ * direct branch instead of ending the TB, and leave through a side exit
+ * to the other successor.  Conditional branches are predicted taken when
+ * backward and not taken when forward.  A followed branch must target the
+ * page of the start of the TB, at or after it, so that the TB still
+ * covers all the code it was translated from.
+ */
+static bool gen_jmp_follow(DisasContext *s, uint32_t dest)
+{
+    uint32_t next = s->base.pc_next;
+    bool taken = !s->condjmp || dest <= s->pc_curr;
+    TCGLabel *follow;
+
+    if (!s->base.superblock || s->base.is_jmp != DISAS_NEXT ||
+        s->ss_active || s->condexec_mask || s->eci ||
+        s->sb_followed >= SB_MAX_FOLLOWED) {
+        return false;
+    }
+    if (taken && (dest < s->base.pc_first ||
+                  ((dest ^ s->base.pc_first) & TARGET_PAGE_MASK))) {
+        return false;
+    }
+    s->sb_followed++;
+
+    if (!taken) {
+        /* Side exit to the target, then on with the next insn */
+        gen_set_pc_im(s, dest);
+        gen_goto_ptr();
+        gen_set_label(s->condlabel);
+        s->condjmp = 0;
+        return true;
+    }
+    if (s->condjmp) {
+        /* Side exit to the next insn when the condition fails */
+        follow = gen_new_label();
+        tcg_gen_br(follow);
+        gen_set_label(s->condlabel);
+        gen_set_pc_im(s, next);
+        gen_goto_ptr();
+        gen_set_label(follow);
+        s->condjmp = 0;
+    }
+    s->base.pc_max = MAX(s->base.pc_max, next);
+    s->base.pc_next = dest;
+    return true;
+}
+
 /* Jump, specifying which TB number to use if we gen_goto_tb() */
 static inline void gen_jmp_tb(DisasContext *s, uint32_t dest, int tbno)
 {
@@ -2659,6 +2724,14 @@ static inline void gen_jmp(DisasContext *s, uint32_t dest)
     gen_jmp_tb(s, dest, 0);
 }
 
+/* Plain direct branch, which a superblock may follow */
+static void gen_direct_jmp(DisasContext *s, uint32_t dest)
+{
+    if (!gen_jmp_follow(s, dest)) {
+        gen_jmp(s, dest);
+    }
+}
+
 static inline void gen_mulxy(TCGv_i32 t0, TCGv_i32 t1, int x, int y)
 {
     if (x)
@@ -6649,6 +6722,118 @@ static bool trans_TT(DisasContext *s, arg_TT *a)
     return true;
 }
 
+/*
+ * Bit-band accesses to the SRAM alias at 0x22000000, done as a
+ * read-modify-write of the aliased byte at 0x20000000 rather than
+ * through the bitband device.  The address and value are kept in
+ * local temps, as the caller still needs them after the branches.
+ *
+ * The test and branch end the TCG basic block, so it is only emitted
+ * when the base register @rn can point into the alias.  Stack and
+ * literal accesses never do in practice; if one does, it still reaches
+ * the alias through the bitband device.
+ */
+#define BITBAND_SRAM_ALIAS  0x22000000
+#define BITBAND_SRAM_BASE   0x20000000
+
+static void gen_bitband_addr(TCGv_i32 byte, TCGv_i32 bit, TCGv_i32 addr)
+{
+    tcg_gen_extract_i32(byte, addr, 5, 20);
+    tcg_gen_ori_i32(byte, byte, BITBAND_SRAM_BASE);
+    tcg_gen_extract_i32(bit, addr, 2, 3);
+}
+
+static bool bitband_maybe(DisasContext *s, int rn)
+{
+    return s->bitband && rn != 13 && rn != 15;
+}
+
+static void gen_aa32_ld_bitband(DisasContext *s, TCGv_i32 val,
+                                TCGv_i32 addr, int index, MemOp opc, int rn)
+{
+    TCGv_i32 laddr, lval, byte, bit;
+    TCGLabel *plain, *done;
+
+    if (!bitband_maybe(s, rn)) {
+        gen_aa32_ld_i32(s, val, addr, index, opc);
+        return;
+    }
+    laddr = tcg_temp_local_new_i32();
+    lval = tcg_temp_local_new_i32();
+    plain = gen_new_label();
+    done = gen_new_label();
+
+    tcg_gen_mov_i32(laddr, addr);
+    byte = tcg_temp_new_i32();
+    tcg_gen_andi_i32(byte, laddr, 0xfe000000);
+    tcg_gen_brcondi_i32(TCG_COND_NE, byte, BITBAND_SRAM_ALIAS, plain);
+
+    bit = tcg_temp_new_i32();
+    gen_bitband_addr(byte, bit, laddr);
+    gen_aa32_ld_i32(s, lval, byte, index, MO_UB);
+    tcg_gen_shr_i32(lval, lval, bit);
+    tcg_gen_andi_i32(lval, lval, 1);
+    tcg_temp_free_i32(bit);
+    tcg_temp_free_i32(byte);
+    tcg_gen_br(done);
+
+    gen_set_label(plain);
+    gen_aa32_ld_i32(s, lval, laddr, index, opc);
+
+    gen_set_label(done);
+    tcg_gen_mov_i32(addr, laddr);
+    tcg_gen_mov_i32(val, lval);
+    tcg_temp_free_i32(laddr);
+    tcg_temp_free_i32(lval);
+}
+
+static void gen_aa32_st_bitband(DisasContext *s, TCGv_i32 val,
+                                TCGv_i32 addr, int index, MemOp opc, int rn)
+{
+    TCGv_i32 laddr, lval, byte, bit, old, set;
+    TCGLabel *plain, *done;
+
+    if (!bitband_maybe(s, rn)) {
+        gen_aa32_st_i32(s, val, addr, index, opc);
+        return;
+    }
+    laddr = tcg_temp_local_new_i32();
+    lval = tcg_temp_local_new_i32();
+    plain = gen_new_label();
+    done = gen_new_label();
+
+    tcg_gen_mov_i32(laddr, addr);
+    tcg_gen_mov_i32(lval, val);
+    byte = tcg_temp_new_i32();
+    tcg_gen_andi_i32(byte, laddr, 0xfe000000);
+    tcg_gen_brcondi_i32(TCG_COND_NE, byte, BITBAND_SRAM_ALIAS, plain);
+
+    bit = tcg_temp_new_i32();
+    old = tcg_temp_new_i32();
+    set = tcg_temp_new_i32();
+    gen_bitband_addr(byte, bit, laddr);
+    gen_aa32_ld_i32(s, old, byte, index, MO_UB);
+    tcg_gen_andi_i32(set, lval, 1);
+    tcg_gen_shl_i32(set, set, bit);
+    tcg_gen_shl_i32(bit, tcg_constant_i32(1), bit);
+    tcg_gen_andc_i32(old, old, bit);
+    tcg_gen_or_i32(old, old, set);
+    gen_aa32_st_i32(s, old, byte, index, MO_UB);
+    tcg_temp_free_i32(set);
+    tcg_temp_free_i32(old);
+    tcg_temp_free_i32(bit);
+    tcg_temp_free_i32(byte);
+    tcg_gen_br(done);
+
+    gen_set_label(plain);
+    gen_aa32_st_i32(s, lval, laddr, index, opc);
+
+    gen_set_label(done);
+    tcg_gen_mov_i32(addr, laddr);
+    tcg_temp_free_i32(laddr);
+    tcg_temp_free_i32(lval);
+}
+
 /*
  * Load/store register index
  */
@@ -6719,7 +6904,7 @@ static bool op_load_rr(DisasContext *s, arg_ldst_rr *a,
     addr = op_addr_rr_pre(s, a);
 
     tmp = tcg_temp_new_i32();
-    gen_aa32_ld_i32(s, tmp, addr, mem_idx, mop);
+    gen_aa32_ld_bitband(s, tmp, addr, mem_idx, mop, a->rn);
     disas_set_da_iss(s, mop, issinfo);
 
     /*
@@ -6748,7 +6933,7 @@ static bool op_store_rr(DisasContext *s, arg_ldst_rr *a,
     addr = op_addr_rr_pre(s, a);
 
     tmp = load_reg(s, a->rt);
-    gen_aa32_st_i32(s, tmp, addr, mem_idx, mop);
+    gen_aa32_st_bitband(s, tmp, addr, mem_idx, mop, a->rn);
     disas_set_da_iss(s, mop, issinfo);
     tcg_temp_free_i32(tmp);
 
@@ -6871,7 +7056,7 @@ static bool op_load_ri(DisasContext *s, arg_ldst_ri *a,
     addr = op_addr_ri_pre(s, a);
 
     tmp = tcg_temp_new_i32();
-    gen_aa32_ld_i32(s, tmp, addr, mem_idx, mop);
+    gen_aa32_ld_bitband(s, tmp, addr, mem_idx, mop, a->rn);
     disas_set_da_iss(s, mop, issinfo);
 
     /*
@@ -6900,7 +7085,7 @@ static bool op_store_ri(DisasContext *s, arg_ldst_ri *a,
     addr = op_addr_ri_pre(s, a);
 
     tmp = load_reg(s, a->rt);
-    gen_aa32_st_i32(s, tmp, addr, mem_idx, mop);
+    gen_aa32_st_bitband(s, tmp, addr, mem_idx, mop, a->rn);
     disas_set_da_iss(s, mop, issinfo);
     tcg_temp_free_i32(tmp);
 
@@ -8327,7 +8512,7 @@ static bool trans_CLRM(DisasContext *s, arg_CLRM *a)
 
 static bool trans_B(DisasContext *s, arg_i *a)
 {
-    gen_jmp(s, read_pc(s) + a->imm);
+    gen_direct_jmp(s, read_pc(s) + a->imm);
     return true;
 }
 
@@ -8342,14 +8527,14 @@ static bool trans_B_cond_thumb(DisasContext *s, arg_ci *a)
         return true;
     }
     arm_skip_unless(s, a->cond);
-    gen_jmp(s, read_pc(s) + a->imm);
+    gen_direct_jmp(s, read_pc(s) + a->imm);
     return true;
 }
 
 static bool trans_BL(DisasContext *s, arg_i *a)
 {
     tcg_gen_movi_i32(cpu_R[14], s->base.pc_next | s->thumb);
-    gen_jmp(s, read_pc(s) + a->imm);
+    gen_direct_jmp(s, read_pc(s) + a->imm);
     return true;
 }
 
@@ -8751,7 +8936,7 @@ static bool trans_CBZ(DisasContext *s, arg_CBZ *a)
     tcg_gen_brcondi_i32(a->nz ? TCG_COND_EQ : TCG_COND_NE,
                         tmp, 0, s->condlabel);
     tcg_temp_free_i32(tmp);
-    gen_jmp(s, read_pc(s) + a->imm);
+    gen_direct_jmp(s, read_pc(s) + a->imm);
     return true;
 }
 
@@ -9334,6 +9519,7 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
      * insn, behave normally".
      */
     dc->eci = dc->condexec_mask = dc->condexec_cond = 0;
+    dc->sb_followed = 0;
     dc->eci_handled = false;
     dc->insn_eci_rewind = NULL;
     if (condexec & 0xf) {
@@ -9383,6 +9569,8 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     }
     dc->cp_regs = cpu->cp_regs;
     dc->features = env->features;
+    dc->hle = cpu->hle_funcs != NULL;
+    dc->bitband = cpu->inline_bitband;
 
     /* Single step state. The code-generation logic here is:
      *  SS_ACTIVE == 0:
@@ -9636,6 +9824,47 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
 
     dc->pc_curr = pc;
     insn = arm_lduw_code(env, &dc->base, pc, dc->sctlr_b);
+
+    if (dc->hle && !dc->condexec_mask && !dc->eci && !dc->ss_active) {
+        int hle = arm_hle_lookup(env_archcpu(env), pc);
+        bool vfp = hle >= 0 && arm_hle_uses_vfp(env_archcpu(env), hle);
+
+        /* With the FPU disabled, the guest code raises NOCP or UNDEF */
+        if (vfp && (dc->fp_excp_el || !dc->vfp_enabled)) {
+            hle = -1;
+        }
+
+        if (hle >= 0) {
+            /*
+             * The TB stops before any emulated function, so this is
+             * always its first insn: call the host implementation and
+             * return to the caller, unless it asks for the guest code
+             * to run after all.
+             */
+            TCGLabel *fallback = gen_new_label();
+            TCGv_i32 done = tcg_temp_new_i32();
+
+            /*
+             * Like the first FP insn of the guest code, preserve the
+             * lazily stacked FP state and set up a new FP context.
+             */
+            if (vfp) {
+                vfp_access_check(dc);
+            }
+            gen_helper_hle_call(done, cpu_env, tcg_constant_i32(hle));
+            tcg_gen_brcondi_i32(TCG_COND_EQ, done, 0, fallback);
+            tcg_temp_free_i32(done);
+            gen_bx_excret(dc, load_reg(dc, 14));
+            if (dc->base.is_jmp == DISAS_BX_EXCRET) {
+                gen_bx_excret_final_code(dc);
+            } else {
+                gen_goto_ptr();
+            }
+            gen_set_label(fallback);
+            dc->base.is_jmp = DISAS_NEXT;
+        }
+    }
+
     is_16bit = thumb_insn_is_16bit(dc, dc->base.pc_next, insn);
     pc += 2;
     if (!is_16bit) {
@@ -9749,6 +9978,12 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
                 && insn_crosses_page(env, dc)))) {
         dc->base.is_jmp = DISAS_TOO_MANY;
     }
+
+    /* Code may run into an emulated function, which must start a TB */
+    if (dc->base.is_jmp == DISAS_NEXT && dc->hle &&
+        arm_hle_lookup(env_archcpu(env), dc->base.pc_next) >= 0) {
+        dc->base.is_jmp = DISAS_TOO_MANY;
+    }
 }
 
 static void arm_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
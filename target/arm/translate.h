@@ -54,6 +54,12 @@ typedef struct DisasContext {
     bool v8m_fpccr_s_wrong; /* true if v8M FPCCR.S != v8m_secure */
     bool v7m_new_fp_ctxt_needed; /* ASPEN set but no active FP context */
     bool v7m_lspact; /* FPCCR.LSPACT set */
+    /* True if some functions are emulated in host code, see hle.c */
+    bool hle;
+    /* True if SRAM bit-band accesses are translated inline */
+    bool bitband;
+    /* Number of direct branches followed in a superblock */
+    int sb_followed;
     /* Immediate value in AArch32 SVC insn; must be set if is_jmp == DISAS_SWI
      * so that top level loop can generate correct syndrome information.
      */
@@ -24,6 +24,7 @@
 #ifdef CONFIG_TCG
 #include "qemu/log.h"
 #include "fpu/softfloat.h"
+#include <fenv.h>
 #endif
 
 /* VFP support.  We follow the convention used for VFP instructions:
@@ -84,10 +85,76 @@ static inline int vfp_exceptbits_to_host(int target_bits)
     return host_bits;
 }
 
+/*
+ * With the x-lazy-fp-flags CPU property, the float_status values are put
+ * in lazy_inexact mode so that hardfloat is used whether or not FPSCR.IXC
+ * is set, and the inexact exceptions it raises accumulate in the host FPU
+ * instead. They are folded back into fp_status when FPSCR is read and when
+ * leaving cpu_exec, and the host flag is cleared when FPSCR is written and
+ * when entering cpu_exec, so that host FP code run outside the guest does
+ * not leak into IXC. The host flags belong to the vCPU thread, so they can
+ * only be looked at from there; other threads only ever see the CPU while
+ * it is outside cpu_exec, where fp_status is up to date.
+ */
+static bool vfp_lazy_flags_local(CPUARMState *env)
+{
+#ifdef FE_INEXACT
+    return env->vfp.fp_status.lazy_inexact && current_cpu == env_cpu(env);
+#else
+    return false;
+#endif
+}
+
+static void vfp_lazy_flags_sync(CPUARMState *env)
+{
+#ifdef FE_INEXACT
+    if (fetestexcept(FE_INEXACT)) {
+        float_raise(float_flag_inexact, &env->vfp.fp_status);
+    }
+#endif
+}
+
+static void vfp_lazy_flags_clear(CPUARMState *env)
+{
+#ifdef FE_INEXACT
+    feclearexcept(FE_INEXACT);
+#endif
+}
+
+void arm_cpu_exec_enter(CPUState *cs)
+{
+    ARMCPU *cpu = ARM_CPU(cs);
+    CPUARMState *env = &cpu->env;
+
+#ifdef FE_INEXACT
+    if (cpu->lazy_fp_flags) {
+        /* The float_status values are cleared on reset */
+        set_lazy_inexact(true, &env->vfp.fp_status);
+        set_lazy_inexact(true, &env->vfp.fp_status_f16);
+        set_lazy_inexact(true, &env->vfp.standard_fp_status);
+        set_lazy_inexact(true, &env->vfp.standard_fp_status_f16);
+        vfp_lazy_flags_clear(env);
+    }
+#endif
+}
+
+void arm_cpu_exec_exit(CPUState *cs)
+{
+    CPUARMState *env = &ARM_CPU(cs)->env;
+
+    if (vfp_lazy_flags_local(env)) {
+        vfp_lazy_flags_sync(env);
+    }
+}
+
 static uint32_t vfp_get_fpscr_from_host(CPUARMState *env)
 {
     uint32_t i;
 
+    if (vfp_lazy_flags_local(env)) {
+        vfp_lazy_flags_sync(env);
+    }
+
     i = get_float_exception_flags(&env->vfp.fp_status);
     i |= get_float_exception_flags(&env->vfp.standard_fp_status);
     /* FZ16 does not generate an input denormal exception.  */
@@ -151,6 +218,9 @@ static void vfp_set_fpscr_to_host(CPUARMState *env, uint32_t val)
     set_float_exception_flags(0, &env->vfp.fp_status_f16);
     set_float_exception_flags(0, &env->vfp.standard_fp_status);
     set_float_exception_flags(0, &env->vfp.standard_fp_status_f16);
+    if (vfp_lazy_flags_local(env)) {
+        vfp_lazy_flags_clear(env);
+    }
 }
 
 #else
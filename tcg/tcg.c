@@ -1467,6 +1467,20 @@ bool tcg_op_supported(TCGOpcode op)
     }
 }
 
+#ifdef CONFIG_PLUGIN
+/*
+ * Lets the plugin code retarget a call op to a helper with other flags,
+ * which are part of the description.
+ */
+TCGArg tcg_helper_info_arg(void *func)
+{
+    const TCGHelperInfo *info = g_hash_table_lookup(helper_table, func);
+
+    tcg_debug_assert(info);
+    return (uintptr_t)info;
+}
+#endif
+
 /* Note: we convert the 64 bit args to 32 bit and do some alignment
    and endian swap. Maybe it would be better to do the alignment
    and endian swap in tcg_reg_alloc_call(). */
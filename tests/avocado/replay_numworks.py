@@ -0,0 +1,227 @@
+# Record/replay test for the NumWorks calculators
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or
+# later.  See the COPYING file in the top-level directory.
+
+import os
+import filecmp
+import logging
+import time
+
+from avocado import skipUnless
+from avocado_qemu import QemuSystemTest
+from avocado.utils import gdb
+from avocado.utils.network.ports import find_free_port
+
+class ReplayNumworks(QemuSystemTest):
+    """
+    Boots an Epsilon firmware in record mode and drives it with a short
+    sequence of key presses.  The VM is then stopped and its SRAM and
+    display are dumped.  The same session is replayed up to the recorded
+    instruction count, and the dumps of both runs must be identical.
+
+    A second recording leaves Epsilon idle, waiting for a key, and checks
+    that the replay log stays small.
+
+    A third recording is replayed under gdb with the in-memory snapshot
+    ring.  Reverse continue from the end of the log back to one of the
+    first instructions has to go through several ring snapshots.
+
+    Epsilon is not distributed with QEMU, so the ELF image has to be
+    provided in the NUMWORKS_EPSILON_ELF environment variable.
+    """
+
+    timeout = 120
+    SRAM_BASE = 0x20000000
+    SRAM_SIZE = 256 * 1024
+    KEYS = ['down', 'down', 'ret', 'esc', 'home']
+    # An idle Epsilon wakes up on its 1 kHz SysTick, and each tick logs
+    # a few instruction and timer checkpoint events.  Anything recorded
+    # per device access, as the RNG used to, exceeds this bound.
+    IDLE_SECONDS = 10
+    IDLE_LOG_BYTES_PER_SECOND = 64 * 1024
+    # rrperiod is in millions of instructions
+    RING_PERIOD = 1
+    STEPS = 10
+    REG_PC = 15
+
+    def run_vm(self, record, shift, replay_path, icount=None):
+        # icount requires TCG to be available
+        self.require_accelerator('tcg')
+
+        logger = logging.getLogger('replay')
+        vm = self.get_vm()
+        if record:
+            logger.info('recording the execution...')
+            mode = 'record'
+        else:
+            logger.info('replaying the execution...')
+            mode = 'replay'
+        vm.add_args('-icount', 'shift=%s,rr=%s,rrfile=%s' %
+                    (shift, mode, replay_path),
+                    '-kernel', self.epsilon,
+                    '-display', 'none',
+                    '-net', 'none',
+                    '-no-reboot')
+        if not record:
+            vm.add_args('-S')
+        vm.launch()
+
+        if record:
+            # let Epsilon boot, then exercise the keypad
+            time.sleep(2)
+            for key in self.KEYS:
+                vm.qmp('send-key', keys=[{'type': 'qcode', 'data': key}])
+                time.sleep(0.5)
+            vm.qmp('stop')
+            icount = vm.qmp('query-replay')['return']['icount']
+        else:
+            vm.qmp('replay-break', icount=icount)
+            vm.qmp('cont')
+            vm.event_wait('STOP')
+
+        prefix = os.path.join(self.workdir, mode)
+        vm.qmp('pmemsave', val=self.SRAM_BASE, size=self.SRAM_SIZE,
+               filename=prefix + '-sram.bin')
+        vm.qmp('screendump', filename=prefix + '-screen.ppm')
+        vm.shutdown()
+        return icount
+
+    def run_rr(self, shift=7):
+        replay_path = os.path.join(self.workdir, 'replay.bin')
+        logger = logging.getLogger('replay')
+
+        icount = self.run_vm(True, shift, replay_path)
+        logger.info('recorded %d instructions with log size %s bytes'
+                    % (icount, os.path.getsize(replay_path)))
+        self.run_vm(False, shift, replay_path, icount)
+
+        for dump in ['sram.bin', 'screen.ppm']:
+            record = os.path.join(self.workdir, 'record-' + dump)
+            replay = os.path.join(self.workdir, 'replay-' + dump)
+            self.assertTrue(filecmp.cmp(record, replay, shallow=False),
+                            '%s differs between record and replay' % dump)
+        logger.info('replay reached an identical state')
+
+    def run_idle(self, shift=7):
+        replay_path = os.path.join(self.workdir, 'idle.bin')
+        logger = logging.getLogger('replay')
+
+        self.require_accelerator('tcg')
+        vm = self.get_vm()
+        vm.add_args('-icount', 'shift=%s,rr=record,rrfile=%s' %
+                    (shift, replay_path),
+                    '-kernel', self.epsilon,
+                    '-display', 'none',
+                    '-net', 'none',
+                    '-no-reboot')
+        vm.launch()
+        time.sleep(self.IDLE_SECONDS)
+        vm.qmp('stop')
+        vm.shutdown()
+
+        size = os.path.getsize(replay_path)
+        logger.info('idle for %d s with log size %d bytes'
+                    % (self.IDLE_SECONDS, size))
+        self.assertLess(size,
+                        self.IDLE_LOG_BYTES_PER_SECOND * self.IDLE_SECONDS,
+                        'replay log too large for an idle session')
+
+    def get_pc(self, g):
+        res = g.cmd(b'p%x' % self.REG_PC)
+        num = 0
+        for i in range(len(res))[-2::-2]:
+            num = 0x100 * num + int(res[i:i + 2], 16)
+        return num
+
+    def check_pc(self, g, addr):
+        pc = self.get_pc(g)
+        if pc != addr:
+            self.fail('Invalid PC (read %x instead of %x)' % (pc, addr))
+
+    @staticmethod
+    def vm_get_icount(vm):
+        return vm.qmp('query-replay')['return']['icount']
+
+    def run_reverse(self, shift=7):
+        replay_path = os.path.join(self.workdir, 'reverse.bin')
+        logger = logging.getLogger('replay')
+        period = self.RING_PERIOD * 1000000
+
+        self.require_accelerator('tcg')
+        vm = self.get_vm()
+        vm.add_args('-icount', 'shift=%s,rr=record,rrfile=%s' %
+                    (shift, replay_path),
+                    '-kernel', self.epsilon,
+                    '-display', 'none',
+                    '-net', 'none',
+                    '-no-reboot')
+        vm.launch()
+        while self.vm_get_icount(vm) <= 3 * period:
+            time.sleep(0.1)
+        vm.qmp('stop')
+        last_icount = self.vm_get_icount(vm)
+        vm.shutdown()
+        logger.info('recorded log with %d instructions' % last_icount)
+
+        port = find_free_port()
+        vm = self.get_vm()
+        vm.add_args('-icount', 'shift=%s,rr=replay,rrfile=%s,rrperiod=%d' %
+                    (shift, replay_path, self.RING_PERIOD),
+                    '-kernel', self.epsilon,
+                    '-display', 'none',
+                    '-net', 'none',
+                    '-no-reboot',
+                    '-gdb', 'tcp::%d' % port, '-S')
+        vm.launch()
+        g = gdb.GDBRemote('127.0.0.1', port, False, False)
+        g.connect()
+        r = g.cmd(b'qSupported')
+        if b'ReverseContinue+' not in r:
+            self.fail('Reverse continue is not supported by QEMU')
+
+        steps = []
+        for _ in range(self.STEPS):
+            steps.append(self.get_pc(g))
+            g.cmd(b's', b'T05thread:01;')
+
+        # Run to the end; the ring snapshots must not stop the VM
+        vm.get_qmp_events(wait=False)
+        vm.qmp('replay-break', icount=last_icount - 1)
+        g.cmd(b'c', b'T02thread:01;')
+        events = [e['event'] for e in vm.get_qmp_events(wait=False)]
+        self.assertEqual(events.count('RESUME'), 1,
+                         'snapshots changed the run state: %s' % events)
+
+        # Assume that the last step is not executed again later
+        g.cmd(b'Z1,%x,1' % steps[-1], b'OK')
+        g.cmd(b'bc', b'T05thread:01;')
+        self.check_pc(g, steps[-1])
+        self.assertEqual(self.vm_get_icount(vm), self.STEPS - 1)
+        logger.info('reverse continue went back from %d to %d'
+                    % (last_icount - 1, self.STEPS - 1))
+        vm.shutdown()
+
+    @skipUnless(os.getenv('NUMWORKS_EPSILON_ELF'),
+                'NUMWORKS_EPSILON_ELF is not set')
+    def test_arm_n0110(self):
+        """
+        :avocado: tags=arch:arm
+        :avocado: tags=machine:n0110
+        """
+        self.epsilon = os.getenv('NUMWORKS_EPSILON_ELF')
+        self.run_rr()
+        self.run_idle()
+        self.run_reverse()
+
+    @skipUnless(os.getenv('NUMWORKS_EPSILON_N0100_ELF'),
+                'NUMWORKS_EPSILON_N0100_ELF is not set')
+    def test_arm_n0100(self):
+        """
+        :avocado: tags=arch:arm
+        :avocado: tags=machine:n0100
+        """
+        self.epsilon = os.getenv('NUMWORKS_EPSILON_N0100_ELF')
+        self.run_rr()
+        self.run_idle()
+        self.run_reverse()
@@ -0,0 +1,285 @@
+/*
+ * Benchmark firmware for the NumWorks N0100 and N0110 machines
+ *
+ * A bare-metal program that exercises the parts of the emulator an
+ * Epsilon session depends on: plain code execution, pixel transfers to
+ * the ST7789V, keypad scanning through the GPIOs and interrupt
+ * delivery by the NVIC.  Each workload is timed with the semihosting
+ * SYS_ELAPSED call, which returns host nanoseconds, and reported on the
+ * semihosting console as a "result <name> <count> <ns>" line that
+ * numworks-bench.py turns into JSON.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdint.h>
+
+#define SYS_WRITE0      0x04
+#define SYS_EXIT        0x18
+#define SYS_ELAPSED     0x30
+#define ADP_Stopped_ApplicationExit 0x20026
+
+#define REG32(addr)     (*(volatile uint32_t *)(addr))
+#define REG16(addr)     (*(volatile uint16_t *)(addr))
+
+/* ST7789V on the FMC, with the data/command line on A16 */
+#define LCD_COMMAND     0x60000000
+#define LCD_DATA        0x60020000
+#define LCD_WIDTH       320
+#define LCD_HEIGHT      240
+
+/* Keypad rows are open-drain outputs, columns are pulled-up inputs */
+#ifdef BOARD_N0110
+#define KBD_ROW_GPIO    0x40020000  /* GPIOA */
+#else
+#define KBD_ROW_GPIO    0x40021000  /* GPIOE */
+#endif
+#define KBD_COL_GPIO    0x40020800  /* GPIOC */
+#define KBD_ROWS        9
+#define KBD_COLUMN_MASK 0x3f
+#define GPIO_MODER      0x00
+#define GPIO_IDR        0x10
+#define GPIO_ODR        0x14
+
+/* WWDG is not modelled, so its interrupt line is free to pend by hand */
+#define BENCH_IRQ       0
+#define NVIC_ISER0      0xe000e100
+#define NVIC_ISPR0      0xe000e200
+
+#define ALU_ITERATIONS      2000000
+#define ALU_INSNS_PER_ITER  6
+#define MEM_ITERATIONS      500000
+#define MEM_INSNS_PER_ITER  8
+#define FRAMES              10
+#define KBD_SCANS           20000
+#define IRQS                50000
+
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+
+static volatile uint32_t irq_count;
+static uint32_t mem_buffer[1024];
+
+static inline uint32_t semihost(uint32_t op, const void *arg)
+{
+    register uint32_t r0 asm("r0") = op;
+    register const void *r1 asm("r1") = arg;
+
+    asm volatile("bkpt 0xab" : "+r"(r0) : "r"(r1) : "memory");
+    return r0;
+}
+
+static void print(const char *s)
+{
+    semihost(SYS_WRITE0, s);
+}
+
+static void print_u64(uint64_t v)
+{
+    char buf[21];
+    char *p = buf + sizeof(buf) - 1;
+
+    *p = '\0';
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    print(p);
+}
+
+static uint64_t elapsed_ns(void)
+{
+    uint32_t block[2];
+
+    semihost(SYS_ELAPSED, block);
+    return block[0] | ((uint64_t)block[1] << 32);
+}
+
+static void report(const char *name, uint64_t count, uint64_t ns)
+{
+    print("result ");
+    print(name);
+    print(" ");
+    print_u64(count);
+    print(" ");
+    print_u64(ns);
+    print("\n");
+}
+
+static void lcd_command(uint16_t cmd)
+{
+    REG16(LCD_COMMAND) = cmd;
+}
+
+static void lcd_data(uint16_t data)
+{
+    REG16(LCD_DATA) = data;
+}
+
+static void lcd_init(void)
+{
+    lcd_command(0x11);          /* SLPOUT */
+    lcd_command(0x3a);          /* COLMOD: 16 bits per pixel */
+    lcd_data(0x55);
+    lcd_command(0x36);          /* MADCTL: landscape */
+    lcd_data(0xa0);
+    lcd_command(0x29);          /* DISPON */
+}
+
+static void lcd_push_frame(uint16_t color)
+{
+    uint32_t i;
+
+    lcd_command(0x2a);          /* CASET */
+    lcd_data(0);
+    lcd_data(0);
+    lcd_data((LCD_WIDTH - 1) >> 8);
+    lcd_data((LCD_WIDTH - 1) & 0xff);
+    lcd_command(0x2b);          /* RASET */
+    lcd_data(0);
+    lcd_data(0);
+    lcd_data((LCD_HEIGHT - 1) >> 8);
+    lcd_data((LCD_HEIGHT - 1) & 0xff);
+    lcd_command(0x2c);          /* RAMWR */
+    for (i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++) {
+        lcd_data(color + i);
+    }
+}
+
+/* ALU_INSNS_PER_ITER instructions per iteration */
+static void bench_alu(void)
+{
+    uint32_t n = ALU_ITERATIONS, a = 1, b = 2, c = 3;
+    uint64_t start = elapsed_ns();
+
+    asm volatile("1:\n"
+                 "    adds %1, %1, %0\n"
+                 "    eors %2, %2, %1\n"
+                 "    lsls %3, %1, #3\n"
+                 "    adds %2, %2, %3\n"
+                 "    subs %0, %0, #1\n"
+                 "    bne 1b\n"
+                 : "+l"(n), "+l"(a), "+l"(b), "+l"(c) : : "cc");
+    report("alu", (uint64_t)ALU_ITERATIONS * ALU_INSNS_PER_ITER,
+           elapsed_ns() - start);
+}
+
+/* MEM_INSNS_PER_ITER instructions per iteration, walking mem_buffer */
+static void bench_mem(void)
+{
+    uint32_t n = MEM_ITERATIONS, i = 0, t, u;
+    uint32_t *base = mem_buffer;
+    uint64_t start = elapsed_ns();
+
+    asm volatile("1:\n"
+                 "    ldr %2, [%4, %1]\n"
+                 "    ldr %3, [%4]\n"
+                 "    adds %2, %2, %3\n"
+                 "    str %2, [%4, %1]\n"
+                 "    adds %1, %1, #4\n"
+                 "    bfc %1, #12, #20\n"
+                 "    subs %0, %0, #1\n"
+                 "    bne 1b\n"
+                 : "+r"(n), "+r"(i), "=&r"(t), "=&r"(u)
+                 : "r"(base) : "cc", "memory");
+    report("mem", (uint64_t)MEM_ITERATIONS * MEM_INSNS_PER_ITER,
+           elapsed_ns() - start);
+}
+
+static void bench_lcd(void)
+{
+    uint64_t start = elapsed_ns();
+    int f;
+
+    for (f = 0; f < FRAMES; f++) {
+        lcd_push_frame(f << 11);
+    }
+    report("lcd", (uint64_t)FRAMES * LCD_WIDTH * LCD_HEIGHT,
+           elapsed_ns() - start);
+}
+
+static void bench_keypad(void)
+{
+    uint32_t scan, row, state = 0;
+    uint64_t start;
+
+    REG32(KBD_ROW_GPIO + GPIO_MODER) = (REG32(KBD_ROW_GPIO + GPIO_MODER) &
+                                        ~0x3ffffu) | 0x15555u;
+    REG32(KBD_COL_GPIO + GPIO_MODER) &= ~0xfffu;
+
+    start = elapsed_ns();
+    for (scan = 0; scan < KBD_SCANS; scan++) {
+        for (row = 0; row < KBD_ROWS; row++) {
+            REG32(KBD_ROW_GPIO + GPIO_ODR) = ~(1u << row) & 0x1ff;
+            state ^= REG32(KBD_COL_GPIO + GPIO_IDR) & KBD_COLUMN_MASK;
+        }
+    }
+    report("keypad", KBD_SCANS, elapsed_ns() - start);
+    (void)state;
+}
+
+void bench_irq_handler(void)
+{
+    irq_count++;
+}
+
+static void bench_irq(void)
+{
+    uint32_t i;
+    uint64_t start;
+
+    REG32(NVIC_ISER0) = 1u << BENCH_IRQ;
+    irq_count = 0;
+
+    start = elapsed_ns();
+    for (i = 0; i < IRQS; i++) {
+        REG32(NVIC_ISPR0) = 1u << BENCH_IRQ;
+        while (irq_count == i) {
+            /* wait for the handler */
+        }
+    }
+    report("irq", IRQS, elapsed_ns() - start);
+}
+
+void reset_handler(void)
+{
+    uint32_t *src, *dst;
+
+    for (src = &_sidata, dst = &_sdata; dst < &_edata;) {
+        *dst++ = *src++;
+    }
+    for (dst = &_sbss; dst < &_ebss;) {
+        *dst++ = 0;
+    }
+
+    lcd_init();
+    lcd_push_frame(0);
+    print("first-frame\n");
+
+    bench_alu();
+    bench_mem();
+    bench_lcd();
+    bench_keypad();
+    bench_irq();
+
+    semihost(SYS_EXIT, (void *)ADP_Stopped_ApplicationExit);
+    for (;;) {
+    }
+}
+
+void default_handler(void)
+{
+    print("unexpected exception\n");
+    semihost(SYS_EXIT, (void *)0);
+    for (;;) {
+    }
+}
+
+__attribute__((section(".vectors"), used))
+static void (*const vectors[16 + 96])(void) = {
+    [0] = (void (*)(void))&_estack,
+    [1] = reset_handler,
+    [2 ... 15] = default_handler,
+    [16 ... 16 + 95] = default_handler,
+    [16 + BENCH_IRQ] = bench_irq_handler,
+};
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# Run the NumWorks benchmark firmware and report the results as JSON
+#
+# Boots bench-<machine>.elf (built by the Makefile next to this script)
+# on each requested NumWorks machine, parses the "result" lines it
+# prints on the semihosting console and turns them into rates.  The
+# boot-to-first-frame time is measured on the host, from the start of
+# the QEMU process to the "first-frame" line.
+#
+# Example, comparing a patch against the current tree:
+#
+#   make -C tests/bench/numworks
+#   tests/bench/numworks/numworks-bench.py --qemu build/qemu-system-arm \
+#       --firmware-dir tests/bench/numworks -o before.json
+#
+# Arguments after "--" are passed to QEMU, e.g. "-- -M hle=on".
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or later.
+# See the COPYING file in the top-level directory.
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import threading
+import time
+
+
+MACHINES = ['n0100', 'n0110']
+
+
+def run_once(qemu, machine, firmware, extra_args, timeout):
+    cmd = [qemu, '-M', machine, '-display', 'none', '-nodefaults',
+           '-semihosting-config', 'enable=on,target=native',
+           '-kernel', firmware] + extra_args
+    results = {}
+    first_frame = None
+
+    start = time.monotonic()
+    with subprocess.Popen(cmd, stdin=subprocess.DEVNULL,
+                          stdout=subprocess.DEVNULL,
+                          stderr=subprocess.PIPE,
+                          universal_newlines=True) as proc:
+        watchdog = threading.Timer(timeout, proc.kill)
+        watchdog.start()
+        try:
+            for line in proc.stderr:
+                words = line.split()
+                if words == ['first-frame'] and first_frame is None:
+                    first_frame = time.monotonic() - start
+                elif len(words) == 4 and words[0] == 'result':
+                    results[words[1]] = (int(words[2]), int(words[3]))
+                elif line.strip():
+                    sys.stderr.write(f'{machine}: {line}')
+            proc.wait()
+        finally:
+            watchdog.cancel()
+    if proc.returncode != 0:
+        raise RuntimeError(f'{machine}: QEMU exited with status '
+                           f'{proc.returncode}')
+    if first_frame is None:
+        raise RuntimeError(f'{machine}: the firmware never drew a frame')
+
+    missing = {'alu', 'mem', 'lcd', 'keypad', 'irq'} - results.keys()
+    if missing:
+        raise RuntimeError(f'{machine}: no result for {", ".join(missing)}')
+
+    def rate(name, scale):
+        count, ns = results[name]
+        return count * scale / max(ns, 1)
+
+    pixels_per_frame = 320 * 240
+    return {
+        'boot_to_first_frame_ms': first_frame * 1e3,
+        'mips_alu': rate('alu', 1e3),
+        'mips_mem': rate('mem', 1e3),
+        'lcd_mpixels_per_s': rate('lcd', 1e3),
+        'lcd_frames_per_s': rate('lcd', 1e9) / pixels_per_frame,
+        'keypad_scans_per_s': rate('keypad', 1e9),
+        'irq_latency_ns': results['irq'][1] / results['irq'][0],
+    }
+
+
+def median_of(runs):
+    return {key: statistics.median(run[key] for run in runs)
+            for key in runs[0]}
+
+
+def qemu_version(qemu):
+    out = subprocess.run([qemu, '--version'], stdout=subprocess.PIPE,
+                         universal_newlines=True, check=True).stdout
+    return out.splitlines()[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Benchmark QEMU on the NumWorks machines')
+    parser.add_argument('--qemu', default=os.environ.get('QEMU',
+                                                         'qemu-system-arm'),
+                        help='QEMU binary (default: $QEMU or '
+                        'qemu-system-arm)')
+    parser.add_argument('--firmware-dir', default='.',
+                        help='directory containing bench-<machine>.elf')
+    parser.add_argument('-m', '--machine', action='append',
+                        choices=MACHINES,
+                        help='machine to benchmark (default: all)')
+    parser.add_argument('-r', '--repeat', type=int, default=3,
+                        help='runs per machine, the median is reported')
+    parser.add_argument('-t', '--timeout', type=float, default=300,
+                        help='timeout of a single run in seconds')
+    parser.add_argument('-o', '--output',
+                        help='write the JSON results to this file')
+    parser.add_argument('qemu_args', nargs='*',
+                        help='extra QEMU arguments, after "--"')
+    args = parser.parse_args()
+
+    report = {
+        'qemu': args.qemu,
+        'qemu_version': qemu_version(args.qemu),
+        'qemu_args': args.qemu_args,
+        'host': platform.platform(),
+        'repeat': args.repeat,
+        'machines': {},
+    }
+    for machine in args.machine or MACHINES:
+        firmware = os.path.join(args.firmware_dir, f'bench-{machine}.elf')
+        if not os.path.exists(firmware):
+            sys.exit(f'{firmware} not found, build it with "make -C '
+                     'tests/bench/numworks"')
+        runs = [run_once(args.qemu, machine, firmware, args.qemu_args,
+                         args.timeout)
+                for _ in range(args.repeat)]
+        report['machines'][machine] = median_of(runs)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(report, f, indent=2)
+            f.write('\n')
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+/*
+ * QTest testcase for in-memory checkpoints on the NumWorks N0110
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define SRAM_BASE   0x20000000
+#define CRC_IDR     0x40023004
+
+static QDict *checkpoint_cmd(QTestState *qts, const char *cmd)
+{
+    QDict *resp, *ret;
+
+    resp = qtest_qmp(qts, "{ 'execute': %s }", cmd);
+    g_assert(qdict_haskey(resp, "return"));
+    ret = qdict_get_qdict(resp, "return");
+    qobject_ref(ret);
+    qobject_unref(resp);
+    return ret;
+}
+
+static void test_restore(void)
+{
+    QTestState *qts = qtest_init("-machine n0110 -accel tcg -S");
+    QDict *info;
+
+    qtest_writel(qts, SRAM_BASE, 0x12345678);
+    qtest_writel(qts, SRAM_BASE + 0x20000, 0xcafe0000);
+    qtest_writel(qts, CRC_IDR, 0x5a);
+    qobject_unref(checkpoint_cmd(qts, "x-checkpoint-save"));
+
+    qtest_writel(qts, SRAM_BASE, 0xdeadbeef);
+    qtest_writel(qts, CRC_IDR, 0xa5);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE), ==, 0xdeadbeef);
+
+    info = checkpoint_cmd(qts, "x-checkpoint-restore");
+    g_assert_cmpint(qdict_get_int(info, "dirty-pages"), ==, 1);
+    g_assert_cmpint(qdict_get_int(info, "code-pages"), ==, 0);
+    qobject_unref(info);
+
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE), ==, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE + 0x20000), ==, 0xcafe0000);
+    g_assert_cmphex(qtest_readl(qts, CRC_IDR), ==, 0x5a);
+
+    /* The checkpoint survives a restore and nothing is dirty any more */
+    info = checkpoint_cmd(qts, "x-checkpoint-restore");
+    g_assert_cmpint(qdict_get_int(info, "dirty-pages"), ==, 0);
+    qobject_unref(info);
+
+    qobject_unref(checkpoint_cmd(qts, "x-checkpoint-discard"));
+    qtest_quit(qts);
+}
+
+static void test_restore_without_checkpoint(void)
+{
+    QTestState *qts = qtest_init("-machine n0110 -accel tcg -S");
+    QDict *resp;
+
+    resp = qtest_qmp(qts, "{ 'execute': 'x-checkpoint-restore' }");
+    g_assert(qdict_haskey(resp, "error"));
+    qobject_unref(resp);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/numworks/checkpoint/restore", test_restore);
+    qtest_add_func("/numworks/checkpoint/no-checkpoint",
+                   test_restore_without_checkpoint);
+
+    return g_test_run();
+}
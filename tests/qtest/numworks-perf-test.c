@@ -0,0 +1,258 @@
+/*
+ * QTest micro-benchmarks of the NumWorks hot peripherals
+ *
+ * Drives the ST7789V, the keypad GPIOs and the CRC unit with the bulk
+ * access patterns of Epsilon and checks that every access reaches the
+ * device.  In performance mode (-m perf), it also fails when the host
+ * time spent in the device callbacks regresses by a large factor.  The
+ * device time comes from x-query-mmio-profile, so the cost of the qtest
+ * protocol, which dominates the wall time, is not part of the comparison.
+ * Timings are only reported otherwise, as they depend on the load of
+ * the host.
+ *
+ * The built-in baseline is deliberately generous so that it holds on
+ * slow hosts and debug builds.  To track a given host more closely,
+ * record its own numbers and compare against them later:
+ *
+ *   QTEST_NUMWORKS_PERF_RECORD=perf.txt ./numworks-perf-test -m perf
+ *   QTEST_NUMWORKS_PERF_BASELINE=perf.txt ./numworks-perf-test -m perf
+ *
+ * QTEST_NUMWORKS_PERF_TOLERANCE sets the factor by which a benchmark
+ * may exceed its baseline (default: 4).
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+
+#define GPIOA_BASE      0x40020000
+#define GPIOC_BASE      0x40020800
+#define GPIO_IDR        0x10
+#define GPIO_ODR        0x14
+
+#define CRC_BASE        0x40023000
+#define CRC_DR          0x00
+
+#define LCD_COMMAND     0x60000000
+#define LCD_DATA        0x60020000
+#define LCD_PIXELS      (320 * 240)
+
+#define KBD_SCANS       10000
+#define KBD_ROWS        9
+#define CRC_WORDS       10000
+
+#define DEFAULT_TOLERANCE 4.0
+
+typedef struct PerfBaseline {
+    const char *name;
+    double ns_per_access;
+} PerfBaseline;
+
+/* Host nanoseconds per MMIO access, including the profiling overhead */
+static PerfBaseline baselines[] = {
+    { "st7789v-fill", 300 },
+    { "keypad-scan", 500 },
+    { "crc-words", 300 },
+};
+
+static double tolerance = DEFAULT_TOLERANCE;
+static FILE *record;
+
+static void load_baseline(const char *filename)
+{
+    g_autofree char *contents = NULL;
+    g_auto(GStrv) lines = NULL;
+    GError *err = NULL;
+    int i, j;
+
+    if (!g_file_get_contents(filename, &contents, NULL, &err)) {
+        g_error("cannot read the baseline: %s", err->message);
+    }
+    lines = g_strsplit(contents, "\n", -1);
+    for (i = 0; lines[i]; i++) {
+        char name[64];
+        double ns;
+
+        if (sscanf(lines[i], "%63s %lf", name, &ns) != 2) {
+            continue;
+        }
+        for (j = 0; j < ARRAY_SIZE(baselines); j++) {
+            if (!strcmp(baselines[j].name, name)) {
+                baselines[j].ns_per_access = ns;
+            }
+        }
+    }
+}
+
+static void profile_start(QTestState *qts)
+{
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-mmio-profile',"
+                             "  'arguments': { 'enable': true,"
+                             "                 'reset': true } }");
+}
+
+/* Stop profiling and return the mean callback time per access */
+static double profile_stop(QTestState *qts, uint64_t *accesses)
+{
+    uint64_t ns = 0, count = 0;
+    QListEntry *e;
+    QDict *resp;
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-mmio-profile',"
+                             "  'arguments': { 'enable': false } }");
+    resp = qtest_qmp(qts, "{ 'execute': 'x-query-mmio-profile' }");
+    g_assert(qdict_haskey(resp, "return"));
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(resp, "return"), e) {
+        QDict *entry = qobject_to(QDict, qlist_entry_obj(e));
+
+        count += qdict_get_int(entry, "reads") +
+                 qdict_get_int(entry, "writes");
+        ns += qdict_get_int(entry, "read-ns") +
+              qdict_get_int(entry, "write-ns");
+    }
+    qobject_unref(resp);
+
+    *accesses = count;
+    return count ? (double)ns / count : 0;
+}
+
+static void check_baseline(const char *name, double ns_per_access,
+                           uint64_t accesses, gint64 wall_us)
+{
+    const PerfBaseline *b = NULL;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(baselines); i++) {
+        if (!strcmp(baselines[i].name, name)) {
+            b = &baselines[i];
+        }
+    }
+    g_assert(b);
+
+    g_test_message("%s: %" PRIu64 " accesses, %.1f ns per access in the "
+                   "device (baseline %.1f), %.1f us per access overall",
+                   name, accesses, ns_per_access, b->ns_per_access,
+                   (double)wall_us / accesses);
+    if (record) {
+        fprintf(record, "%s %.1f\n", name, ns_per_access);
+    }
+    if (g_test_perf()) {
+        g_assert_cmpfloat(ns_per_access, <=, b->ns_per_access * tolerance);
+    }
+}
+
+static QTestState *perf_init(void)
+{
+    return qtest_init("-machine n0110 -accel tcg -S");
+}
+
+static void test_st7789v_fill(void)
+{
+    QTestState *qts = perf_init();
+    uint64_t accesses;
+    gint64 start;
+    double ns;
+    int i;
+
+    qtest_writew(qts, LCD_COMMAND, 0x2c);       /* RAMWR */
+
+    profile_start(qts);
+    start = g_get_monotonic_time();
+    for (i = 0; i < LCD_PIXELS; i++) {
+        qtest_writew(qts, LCD_DATA, i);
+    }
+    ns = profile_stop(qts, &accesses);
+    g_assert_cmpint(accesses, ==, LCD_PIXELS);
+    check_baseline("st7789v-fill", ns, accesses,
+                   g_get_monotonic_time() - start);
+
+    qtest_quit(qts);
+}
+
+static void test_keypad_scan(void)
+{
+    QTestState *qts = perf_init();
+    uint64_t accesses;
+    gint64 start;
+    double ns;
+    int scan, row;
+
+    profile_start(qts);
+    start = g_get_monotonic_time();
+    for (scan = 0; scan < KBD_SCANS; scan++) {
+        for (row = 0; row < KBD_ROWS; row++) {
+            qtest_writel(qts, GPIOA_BASE + GPIO_ODR, ~(1u << row) & 0x1ff);
+            g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & 0x3f,
+                            ==, 0x3f);
+        }
+    }
+    ns = profile_stop(qts, &accesses);
+    g_assert_cmpint(accesses, ==, KBD_SCANS * KBD_ROWS * 2);
+    check_baseline("keypad-scan", ns, accesses,
+                   g_get_monotonic_time() - start);
+
+    qtest_quit(qts);
+}
+
+static void test_crc_words(void)
+{
+    QTestState *qts = perf_init();
+    uint64_t accesses;
+    gint64 start;
+    double ns;
+    int i;
+
+    profile_start(qts);
+    start = g_get_monotonic_time();
+    for (i = 0; i < CRC_WORDS; i++) {
+        qtest_writel(qts, CRC_BASE + CRC_DR, i);
+    }
+    ns = profile_stop(qts, &accesses);
+    g_assert_cmpint(accesses, ==, CRC_WORDS);
+    check_baseline("crc-words", ns, accesses,
+                   g_get_monotonic_time() - start);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    const char *env;
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    if (!qtest_has_machine("n0110")) {
+        return 0;
+    }
+
+    env = getenv("QTEST_NUMWORKS_PERF_BASELINE");
+    if (env) {
+        load_baseline(env);
+    }
+    env = getenv("QTEST_NUMWORKS_PERF_TOLERANCE");
+    if (env) {
+        tolerance = g_ascii_strtod(env, NULL);
+        g_assert_cmpfloat(tolerance, >, 0);
+    }
+    env = getenv("QTEST_NUMWORKS_PERF_RECORD");
+    if (env) {
+        record = fopen(env, "w");
+        g_assert(record);
+    }
+
+    qtest_add_func("/numworks/perf/st7789v-fill", test_st7789v_fill);
+    qtest_add_func("/numworks/perf/keypad-scan", test_keypad_scan);
+    qtest_add_func("/numworks/perf/crc-words", test_crc_words);
+
+    ret = g_test_run();
+
+    if (record) {
+        fclose(record);
+    }
+    return ret;
+}
@@ -0,0 +1,817 @@
+/*
+ * QTest testcase for the NumWorks N0100 and N0110 machines
+ *
+ * Register-level checks of the STM32 peripherals and of the board
+ * devices that Epsilon drives: GPIO, SYSCFG/EXTI, CRC, RNG, the ST7789V
+ * display controller and the GPIO keypad, plus the translation
+ * statistics of the code they run, the inline SRAM bit-band accesses, the
+ * lazy FPSCR.IXC, the superblock side exits and the execution budgets.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/timer.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+#include "qapi/qmp/qnum.h"
+
+#define FLASH_BASE      0x08000000
+#define SRAM_BASE       0x20000000
+
+#define GPIOA_BASE      0x40020000
+#define GPIOC_BASE      0x40020800
+#define GPIOE_BASE      0x40021000
+#define GPIO_IDR        0x10
+#define GPIO_ODR        0x14
+#define GPIO_BSRR       0x18
+
+#define SYSCFG_BASE     0x40013800
+#define SYSCFG_EXTICR1  0x08
+
+#define EXTI_BASE       0x40013c00
+#define EXTI_IMR        0x00
+#define EXTI_RTSR       0x08
+#define EXTI_FTSR       0x0c
+#define EXTI_PR         0x14
+
+#define CRC_BASE        0x40023000
+#define CRC_DR          0x00
+#define CRC_IDR         0x04
+#define CRC_CR          0x08
+
+#define RNG_BASE        0x50060800
+#define RNG_CR          0x00
+#define RNG_SR          0x04
+#define RNG_DR          0x08
+
+#define LCD_COMMAND     0x60000000
+#define LCD_DATA        0x60020000
+
+#define KBD_COLUMNS     0x3f
+
+#define SPIN_PC         (FLASH_BASE + 8)
+
+/* Where the test firmwares store their results, followed by a done flag */
+#define RESULTS_BASE    (SRAM_BASE + 0x200)
+
+#define BITBAND_DATA    (SRAM_BASE + 0x100)
+#define BITBAND_COUNT   8
+
+#define SUPERBLOCK_COUNT 5
+
+#define FPSCR_IXC       (1 << 4)
+#define LAZY_FP_COUNT   5
+
+typedef struct NumworksBoard {
+    const char *machine;
+    const char *soc_type;
+    const char *cpu_type;
+    uint32_t row_gpio;
+    int ok_row;                 /* row of the OK key, in column 4 */
+} NumworksBoard;
+
+static const NumworksBoard boards[] = {
+    { "n0100", "stm32f4xx-soc", "cortex-m4-arm-cpu", GPIOE_BASE, 0 },
+    { "n0110", "stm32f730-soc", "cortex-m7-arm-cpu", GPIOA_BASE, 1 },
+};
+
+static QTestState *board_init(const NumworksBoard *board)
+{
+    return qtest_initf("-machine %s -accel tcg -S", board->machine);
+}
+
+/*
+ * Boot a raw firmware image loaded at the start of the flash.  An -accel
+ * option in @args comes first, so it is tried before the plain TCG one.
+ */
+static QTestState *board_init_firmware(const NumworksBoard *board,
+                                       const char *args,
+                                       const uint8_t *firmware, size_t size)
+{
+    g_autofree char *path = NULL;
+    QTestState *qts;
+    int fd;
+
+    fd = g_file_open_tmp("numworks-test-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    g_assert_cmpint(write(fd, firmware, size), ==, size);
+    close(fd);
+
+    qts = qtest_initf("-machine %s %s -accel tcg "
+                      "-device loader,file=%s,addr=0x%x,force-raw=on",
+                      board->machine, args, path, FLASH_BASE);
+    unlink(path);
+    return qts;
+}
+
+/*
+ * Boot @firmware, which stores @count words at RESULTS_BASE followed by
+ * a done flag of 1, and read the words back.
+ */
+static void board_run_firmware(const NumworksBoard *board, const char *args,
+                               const uint8_t *firmware, size_t size,
+                               uint32_t *results, int count)
+{
+    QTestState *qts;
+    int i;
+
+    qts = board_init_firmware(board, args, firmware, size);
+    for (i = 0; i < 500 && !qtest_readl(qts, RESULTS_BASE + 4 * count); i++) {
+        g_usleep(10 * 1000);
+    }
+    g_assert_cmpint(qtest_readl(qts, RESULTS_BASE + 4 * count), ==, 1);
+    for (i = 0; i < count; i++) {
+        results[i] = qtest_readl(qts, RESULTS_BASE + 4 * i);
+    }
+    qtest_quit(qts);
+}
+
+/*
+ * Input events are only delivered to a running machine, so boot a
+ * firmware that spins in place: the initial SP, the reset vector and
+ * a "b ." instruction.
+ */
+static QTestState *board_init_running(const NumworksBoard *board,
+                                      const char *args)
+{
+    static const uint8_t spin[] = {
+        0x00, 0x10, 0x00, 0x20,     /* SP = 0x20001000 */
+        0x09, 0x00, 0x00, 0x08,     /* PC = 0x08000008, Thumb */
+        0xfe, 0xe7,                 /* b . */
+    };
+
+    return board_init_firmware(board, args, spin, sizeof(spin));
+}
+
+/* The board devices are created without a parent, so look them up by type */
+static char *unattached_path(QTestState *qts, const char *type_name)
+{
+    g_autofree char *type = g_strdup_printf("child<%s>", type_name);
+    char *path = NULL;
+    QListEntry *e;
+    QDict *resp;
+
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-list',"
+                     "  'arguments': { 'path': '/machine/unattached' } }");
+    g_assert(qdict_haskey(resp, "return"));
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(resp, "return"), e) {
+        QDict *prop = qobject_to(QDict, qlist_entry_obj(e));
+
+        if (!strcmp(qdict_get_str(prop, "type"), type)) {
+            path = g_strdup_printf("/machine/unattached/%s",
+                                   qdict_get_str(prop, "name"));
+            break;
+        }
+    }
+    qobject_unref(resp);
+    g_assert(path);
+    return path;
+}
+
+static char *soc_path(QTestState *qts, const NumworksBoard *board)
+{
+    return unattached_path(qts, board->soc_type);
+}
+
+static void send_key(QTestState *qts, const char *qcode, bool down)
+{
+    qtest_qmp_assert_success(qts,
+        "{ 'execute': 'input-send-event', 'arguments': { 'events': ["
+        "  { 'type': 'key', 'data': { 'down': %i,"
+        "    'key': { 'type': 'qcode', 'data': %s } } } ] } }",
+        down, qcode);
+}
+
+static void test_memory(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init(board);
+
+    /* Flash is read-only */
+    qtest_writel(qts, FLASH_BASE, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, FLASH_BASE), ==, 0);
+
+    qtest_writel(qts, SRAM_BASE, 0xcafebabe);
+    qtest_writew(qts, SRAM_BASE + 0x1000, 0x5a5a);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE), ==, 0xcafebabe);
+    g_assert_cmphex(qtest_readw(qts, SRAM_BASE + 0x1000), ==, 0x5a5a);
+
+    qtest_quit(qts);
+}
+
+static void test_gpio(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init(board);
+    uint32_t gpio = board->row_gpio;
+    uint32_t idr;
+
+    g_assert_cmphex(qtest_readl(qts, gpio + GPIO_ODR), ==, 0);
+
+    qtest_writel(qts, gpio + GPIO_ODR, 0x1234);
+    g_assert_cmphex(qtest_readl(qts, gpio + GPIO_ODR), ==, 0x1234);
+
+    /* BSRR sets the low half and resets the high half */
+    qtest_writel(qts, gpio + GPIO_BSRR, 0x00040001);
+    g_assert_cmphex(qtest_readl(qts, gpio + GPIO_ODR), ==, 0x1231);
+    qtest_writel(qts, gpio + GPIO_BSRR, 0x10000100);
+    g_assert_cmphex(qtest_readl(qts, gpio + GPIO_ODR), ==, 0x0331);
+
+    /* IDR is read-only */
+    idr = qtest_readl(qts, gpio + GPIO_IDR);
+    qtest_writel(qts, gpio + GPIO_IDR, ~idr);
+    g_assert_cmphex(qtest_readl(qts, gpio + GPIO_IDR), ==, idr);
+
+    qtest_quit(qts);
+}
+
+static void test_exti(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init(board);
+    g_autofree char *soc = soc_path(qts, board);
+    g_autofree char *syscfg = g_strdup_printf("%s/syscfg", soc);
+
+    /* Line 3 is routed from port A at reset */
+    g_assert_cmphex(qtest_readl(qts, SYSCFG_BASE + SYSCFG_EXTICR1), ==, 0);
+
+    qtest_writel(qts, EXTI_BASE + EXTI_IMR, 1 << 3);
+    qtest_writel(qts, EXTI_BASE + EXTI_RTSR, 1 << 3);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_IMR), ==, 1 << 3);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_RTSR), ==, 1 << 3);
+
+    /* Only the rising edge is selected */
+    qtest_set_irq_in(qts, syscfg, NULL, 3, 1);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_PR), ==, 1 << 3);
+    qtest_writel(qts, EXTI_BASE + EXTI_PR, 1 << 3);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_PR), ==, 0);
+    qtest_set_irq_in(qts, syscfg, NULL, 3, 0);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_PR), ==, 0);
+
+    qtest_writel(qts, EXTI_BASE + EXTI_FTSR, 1 << 3);
+    qtest_set_irq_in(qts, syscfg, NULL, 3, 1);
+    qtest_set_irq_in(qts, syscfg, NULL, 3, 0);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_PR), ==, 1 << 3);
+
+    /* Routing line 3 to port B disconnects port A */
+    qtest_writel(qts, EXTI_BASE + EXTI_PR, 1 << 3);
+    qtest_writel(qts, SYSCFG_BASE + SYSCFG_EXTICR1, 1 << 12);
+    qtest_set_irq_in(qts, syscfg, NULL, 3, 1);
+    g_assert_cmphex(qtest_readl(qts, EXTI_BASE + EXTI_PR), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_crc(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init(board);
+
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_DR), ==, 0xffffffff);
+
+    /* CRC-32 (poly 0x04c11db7), MSB first, without any reflection */
+    qtest_writel(qts, CRC_BASE + CRC_DR, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_DR), ==, 0xdf8a8a2b);
+    qtest_writel(qts, CRC_BASE + CRC_DR, 0x9abcdef0);
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_DR), ==, 0x7d24a31b);
+
+    qtest_writel(qts, CRC_BASE + CRC_CR, 1);
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_DR), ==, 0xffffffff);
+    qtest_writel(qts, CRC_BASE + CRC_DR, 0);
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_DR), ==, 0xc704dd7b);
+
+    /* IDR is a free 8-bit register */
+    qtest_writel(qts, CRC_BASE + CRC_IDR, 0x1a5);
+    g_assert_cmphex(qtest_readl(qts, CRC_BASE + CRC_IDR), ==, 0xa5);
+
+    qtest_quit(qts);
+}
+
+static void test_rng(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *a, *b;
+    uint32_t first;
+    int i, changes = 0;
+
+    a = qtest_initf("-machine %s -accel tcg -S -seed 42", board->machine);
+    b = qtest_initf("-machine %s -accel tcg -S -seed 42", board->machine);
+
+    qtest_writel(a, RNG_BASE + RNG_CR, 0xff);
+    g_assert_cmphex(qtest_readl(a, RNG_BASE + RNG_CR), ==, 0x6);
+    g_assert_cmphex(qtest_readl(a, RNG_BASE + RNG_SR), ==, 0x1);
+
+    /* The same seed gives the same sequence, which isn't constant */
+    first = qtest_readl(a, RNG_BASE + RNG_DR);
+    g_assert_cmphex(qtest_readl(b, RNG_BASE + RNG_DR), ==, first);
+    for (i = 0; i < 16; i++) {
+        uint32_t v = qtest_readl(a, RNG_BASE + RNG_DR);
+
+        g_assert_cmphex(qtest_readl(b, RNG_BASE + RNG_DR), ==, v);
+        changes += v != first;
+    }
+    g_assert_cmpint(changes, >, 0);
+
+    qtest_quit(b);
+    qtest_quit(a);
+}
+
+static void lcd_command(QTestState *qts, uint16_t cmd)
+{
+    qtest_writew(qts, LCD_COMMAND, cmd);
+}
+
+static void lcd_window(QTestState *qts, int x0, int y0, int x1, int y1)
+{
+    lcd_command(qts, 0x2a);     /* CASET */
+    qtest_writew(qts, LCD_DATA, x0 >> 8);
+    qtest_writew(qts, LCD_DATA, x0 & 0xff);
+    qtest_writew(qts, LCD_DATA, x1 >> 8);
+    qtest_writew(qts, LCD_DATA, x1 & 0xff);
+    lcd_command(qts, 0x2b);     /* RASET */
+    qtest_writew(qts, LCD_DATA, y0 >> 8);
+    qtest_writew(qts, LCD_DATA, y0 & 0xff);
+    qtest_writew(qts, LCD_DATA, y1 >> 8);
+    qtest_writew(qts, LCD_DATA, y1 & 0xff);
+}
+
+static void test_st7789v(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init(board);
+
+    /* RDDID: dummy read, then the three ID bytes */
+    lcd_command(qts, 0x04);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0x85);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0x85);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0x52);
+
+    /* MADCTL round trip through RDDMADCTL */
+    lcd_command(qts, 0x36);
+    qtest_writew(qts, LCD_DATA, 0xa0);
+    lcd_command(qts, 0x0b);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0);
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0xa0);
+    lcd_command(qts, 0x36);
+    qtest_writew(qts, LCD_DATA, 0);
+
+    /* Two RGB565 pixels, read back as 18-bit RGB */
+    lcd_window(qts, 10, 20, 11, 20);
+    lcd_command(qts, 0x2c);     /* RAMWR */
+    qtest_writew(qts, LCD_DATA, 0xf800);
+    qtest_writew(qts, LCD_DATA, 0x07e0);
+    lcd_command(qts, 0x2e);     /* RAMRD */
+    qtest_readw(qts, LCD_DATA);                             /* dummy */
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0xf800); /* R0 G0 */
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0x0000); /* B0 R1 */
+    g_assert_cmphex(qtest_readw(qts, LCD_DATA), ==, 0xfc00); /* G1 B1 */
+
+    qtest_quit(qts);
+}
+
+static void test_st7789v_frame_stats(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts;
+    g_autofree char *path = NULL;
+    QList *histogram;
+    QDict *resp, *stats;
+    int i;
+
+    /* With the qtest accelerator, virtual time only advances on request */
+    qts = qtest_initf("-machine %s", board->machine);
+    path = unattached_path(qts, "st7789v");
+
+    /* A 10x10 window and 100 pixels, written in 1 ms */
+    lcd_window(qts, 0, 0, 9, 9);
+    lcd_command(qts, 0x2c);     /* RAMWR */
+    for (i = 0; i < 100; i++) {
+        qtest_writew(qts, LCD_DATA, i);
+    }
+    qtest_clock_step(qts, 1000 * 1000);
+    lcd_command(qts, 0x00);     /* NOP */
+
+    /* The frame is only accounted for once it is over */
+    qtest_clock_step(qts, 20 * 1000 * 1000);
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-get', 'arguments':"
+                     "  { 'path': %s, 'property': 'frame-stats' } }", path);
+    g_assert(qdict_haskey(resp, "return"));
+    stats = qdict_get_qdict(resp, "return");
+    g_assert_cmpint(qdict_get_int(stats, "frames"), ==, 1);
+    g_assert_cmpint(qdict_get_int(stats, "pixels"), ==, 100);
+    g_assert_cmpint(qdict_get_int(stats, "window-changes"), ==, 2);
+    g_assert_cmpint(qdict_get_int(stats, "bursts"), ==, 1);
+    g_assert_cmpint(qdict_get_int(stats, "burst-ns"), ==, 1000 * 1000);
+    g_assert_cmpint(qdict_get_int(stats, "full-redraws"), ==, 0);
+
+    /* 64 to 127 pixels */
+    histogram = qdict_get_qlist(stats, "pixels-histogram");
+    for (i = 0; !qlist_empty(histogram); i++) {
+        QObject *count = qlist_pop(histogram);
+
+        g_assert_cmpint(qnum_get_int(qobject_to(QNum, count)), ==, i == 6);
+        qobject_unref(count);
+    }
+    /* 512 to 1023 microseconds */
+    histogram = qdict_get_qlist(stats, "burst-ns-histogram");
+    for (i = 0; !qlist_empty(histogram); i++) {
+        QObject *count = qlist_pop(histogram);
+
+        g_assert_cmpint(qnum_get_int(qobject_to(QNum, count)), ==, i == 9);
+        qobject_unref(count);
+    }
+    qobject_unref(resp);
+
+    /* A 40 ms burst from 21 ms covers frames 1 to 3, one record each */
+    lcd_command(qts, 0x2c);     /* RAMWR */
+    qtest_clock_step(qts, 40 * 1000 * 1000);
+    lcd_command(qts, 0x00);     /* NOP */
+    qtest_clock_step(qts, 20 * 1000 * 1000);
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-get', 'arguments':"
+                     "  { 'path': %s, 'property': 'frame-stats' } }", path);
+    g_assert(qdict_haskey(resp, "return"));
+    stats = qdict_get_qdict(resp, "return");
+    g_assert_cmpint(qdict_get_int(stats, "frames"), ==, 4);
+    g_assert_cmpint(qdict_get_int(stats, "bursts"), ==, 2);
+    g_assert_cmpint(qdict_get_int(stats, "burst-ns"), ==, 41 * 1000 * 1000);
+    qobject_unref(resp);
+
+    qtest_quit(qts);
+}
+
+static void select_row(QTestState *qts, const NumworksBoard *board, int row)
+{
+    qtest_writel(qts, board->row_gpio + GPIO_ODR, ~(1u << row) & 0x1ff);
+}
+
+static void test_keypad(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init_running(board, "");
+    int other_row = board->ok_row + 1;
+
+    select_row(qts, board, board->ok_row);
+    g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & KBD_COLUMNS,
+                    ==, KBD_COLUMNS);
+
+    /* Keys pull their column low while their row is selected */
+    send_key(qts, "ret", true);
+    g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & KBD_COLUMNS,
+                    ==, KBD_COLUMNS & ~(1 << 4));
+    select_row(qts, board, other_row);
+    g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & KBD_COLUMNS,
+                    ==, KBD_COLUMNS);
+    select_row(qts, board, board->ok_row);
+    g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & KBD_COLUMNS,
+                    ==, KBD_COLUMNS & ~(1 << 4));
+
+    send_key(qts, "ret", false);
+    g_assert_cmphex(qtest_readl(qts, GPIOC_BASE + GPIO_IDR) & KBD_COLUMNS,
+                    ==, KBD_COLUMNS);
+
+    qtest_quit(qts);
+}
+
+/* The spin loop has no symbol, so its code is grouped by page */
+static int64_t spin_executions(QTestState *qts)
+{
+    int64_t executions = 0;
+    QListEntry *e;
+    QDict *resp;
+
+    resp = qtest_qmp(qts, "{ 'execute': 'x-query-tb-stats' }");
+    g_assert(qdict_haskey(resp, "return"));
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(resp, "return"), e) {
+        QDict *stats = qobject_to(QDict, qlist_entry_obj(e));
+
+        g_assert(qdict_haskey(stats, "executions"));
+        if (g_str_has_prefix(qdict_get_str(stats, "symbol"), "[") &&
+            qdict_get_int(stats, "tbs") > 0) {
+            g_assert_cmpint(qdict_get_int(stats, "code-bytes"), >, 0);
+            executions += qdict_get_int(stats, "executions");
+        }
+    }
+    qobject_unref(resp);
+    return executions;
+}
+
+static void test_tb_stats(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts = board_init_running(board, "");
+    int64_t executions = 0;
+    int i;
+
+    /* Counting executions flushes the cache, so the loop is translated again */
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-tb-stats',"
+                             "  'arguments': { 'enable': true,"
+                             "                 'executions': true } }");
+    for (i = 0; i < 500 && !executions; i++) {
+        g_usleep(10 * 1000);
+        executions = spin_executions(qts);
+    }
+    g_assert_cmpint(executions, >, 0);
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-tb-stats',"
+                             "  'arguments': { 'enable': false } }");
+    qtest_quit(qts);
+}
+
+/*
+ * Run bit-band accesses to the alias of BITBAND_DATA at 0x22002000:
+ * reads, a set and a clear, LDRSB and LDRH, post-indexed, pre-indexed
+ * with writeback and register offset forms.  The values read, the final
+ * writeback address and the data word end up at RESULTS_BASE.
+ */
+static void run_bitband(const NumworksBoard *board, bool inline_bitband,
+                        uint32_t *results)
+{
+    static const uint8_t firmware[] = {
+        0x00, 0x10, 0x00, 0x20,     /* SP = 0x20001000 */
+        0x09, 0x00, 0x00, 0x08,     /* PC = 0x08000008, Thumb */
+        0x40, 0xf2, 0x00, 0x10,     /* movw r0, #0x0100 */
+        0xc2, 0xf2, 0x00, 0x00,     /* movt r0, #0x2000: data */
+        0x42, 0xf2, 0x00, 0x01,     /* movw r1, #0x2000 */
+        0xc2, 0xf2, 0x00, 0x21,     /* movt r1, #0x2200: bit 0 alias */
+        0x40, 0xf2, 0x00, 0x22,     /* movw r2, #0x0200 */
+        0xc2, 0xf2, 0x00, 0x02,     /* movt r2, #0x2000: results */
+        0xa5, 0x23,                 /* movs r3, #0xa5 */
+        0x03, 0x60,                 /* str r3, [r0] */
+        0x0c, 0x68,                 /* ldr r4, [r1]: bit 0 */
+        0x4d, 0x68,                 /* ldr r5, [r1, #4]: bit 1 */
+        0x01, 0x23,                 /* movs r3, #1 */
+        0x4b, 0x60,                 /* str r3, [r1, #4]: set bit 1 */
+        0x00, 0x23,                 /* movs r3, #0 */
+        0x0b, 0x60,                 /* str r3, [r1]: clear bit 0 */
+        0x91, 0xf9, 0x08, 0x60,     /* ldrsb r6, [r1, #8]: bit 2 */
+        0x8f, 0x8a,                 /* ldrh r7, [r1, #20]: bit 5 */
+        0x89, 0x46,                 /* mov r9, r1 */
+        0x59, 0xf8, 0x04, 0x3b,     /* ldr r3, [r9], #4: bit 0 */
+        0x5f, 0xf0, 0x00, 0x08,     /* movs r8, #0 */
+        0x49, 0xf8, 0x04, 0x8f,     /* str r8, [r9, #4]!: clear bit 2 */
+        0x5f, 0xf0, 0x1c, 0x0a,     /* movs r10, #28 */
+        0x51, 0xf8, 0x0a, 0xb0,     /* ldr r11, [r1, r10]: bit 7 */
+        0x5f, 0xf0, 0x01, 0x0c,     /* movs r12, #1 */
+        0x5f, 0xf0, 0x18, 0x0a,     /* movs r10, #24 */
+        0x01, 0xf8, 0x0a, 0xc0,     /* strb r12, [r1, r10]: set bit 6 */
+        0x14, 0x60,                 /* str r4, [r2] */
+        0x55, 0x60,                 /* str r5, [r2, #4] */
+        0x96, 0x60,                 /* str r6, [r2, #8] */
+        0xd7, 0x60,                 /* str r7, [r2, #12] */
+        0x13, 0x61,                 /* str r3, [r2, #16] */
+        0xc2, 0xf8, 0x14, 0x90,     /* str r9, [r2, #20] */
+        0xc2, 0xf8, 0x18, 0xb0,     /* str r11, [r2, #24] */
+        0x03, 0x68,                 /* ldr r3, [r0] */
+        0xd3, 0x61,                 /* str r3, [r2, #28] */
+        0x01, 0x23,                 /* movs r3, #1 */
+        0x13, 0x62,                 /* str r3, [r2, #32]: done */
+        0xfe, 0xe7,                 /* b . */
+    };
+    g_autofree char *args = NULL;
+
+    args = g_strdup_printf("-global %s.inline-bitband=%s", board->soc_type,
+                           inline_bitband ? "on" : "off");
+    board_run_firmware(board, args, firmware, sizeof(firmware),
+                       results, BITBAND_COUNT);
+}
+
+static void test_bitband(const void *data)
+{
+    static const uint32_t expected[BITBAND_COUNT] = {
+        1, 0, 1, 1, 0, 0x22002008, 1, 0xe2,
+    };
+    const NumworksBoard *board = data;
+    uint32_t inlined[BITBAND_COUNT], device[BITBAND_COUNT];
+    int i;
+
+    run_bitband(board, true, inlined);
+    run_bitband(board, false, device);
+    for (i = 0; i < BITBAND_COUNT; i++) {
+        g_assert_cmphex(inlined[i], ==, device[i]);
+        g_assert_cmphex(inlined[i], ==, expected[i]);
+    }
+}
+
+/*
+ * A loop that gets hot enough to be retranslated as a superblock, which
+ * follows its backward branch.  Both of its other exits are side exits:
+ * the forward branch taken once, at iteration 40000, and the end of the
+ * loop.  The flags and counter seen after each of them, and the number
+ * of trips through the forward branch, end up at RESULTS_BASE.
+ */
+static void run_superblock(const NumworksBoard *board, int threshold,
+                           uint32_t *results)
+{
+    static const uint8_t firmware[] = {
+        0x00, 0x10, 0x00, 0x20,     /* SP = 0x20001000 */
+        0x09, 0x00, 0x00, 0x08,     /* PC = 0x08000008, Thumb */
+        0x40, 0xf2, 0x00, 0x22,     /* movw r2, #0x0200 */
+        0xc2, 0xf2, 0x00, 0x02,     /* movt r2, #0x2000: results */
+        0x00, 0x20,                 /* movs r0, #0 */
+        0x4c, 0xf2, 0x50, 0x31,     /* movw r1, #50000 */
+        0x49, 0xf6, 0x40, 0x46,     /* movw r6, #40000 */
+        0x00, 0x25,                 /* movs r5, #0 */
+        0x40, 0x1c,                 /* loop: adds r0, r0, #1 */
+        0xb0, 0x42,                 /* cmp r0, r6 */
+        0x0c, 0xd0,                 /* beq side */
+        0x88, 0x42,                 /* back: cmp r0, r1 */
+        0xfa, 0xd9,                 /* bls loop */
+        0xef, 0xf3, 0x00, 0x83,     /* mrs r3, apsr */
+        0x14, 0x60,                 /* str r4, [r2] */
+        0xc2, 0xf8, 0x04, 0x80,     /* str r8, [r2, #4] */
+        0x93, 0x60,                 /* str r3, [r2, #8] */
+        0xd0, 0x60,                 /* str r0, [r2, #12] */
+        0x15, 0x61,                 /* str r5, [r2, #16] */
+        0x01, 0x23,                 /* movs r3, #1 */
+        0x53, 0x61,                 /* str r3, [r2, #20]: done */
+        0xfe, 0xe7,                 /* b . */
+        0xef, 0xf3, 0x00, 0x84,     /* side: mrs r4, apsr */
+        0x80, 0x46,                 /* mov r8, r0 */
+        0x6d, 0x1c,                 /* adds r5, r5, #1 */
+        0xed, 0xe7,                 /* b back */
+    };
+    g_autofree char *args = NULL;
+
+    args = g_strdup_printf("-accel tcg,superblock-threshold=%d", threshold);
+    board_run_firmware(board, args, firmware, sizeof(firmware),
+                       results, SUPERBLOCK_COUNT);
+}
+
+/* Side exits leave a superblock at the right PC, with the right flags */
+static void test_superblock(const void *data)
+{
+    static const uint32_t expected[SUPERBLOCK_COUNT] = {
+        0x60000000, 40000,          /* Z and C, after the forward branch */
+        0x20000000, 50001,          /* C only, at the end of the loop */
+        1,
+    };
+    const NumworksBoard *board = data;
+    uint32_t superblock[SUPERBLOCK_COUNT], plain[SUPERBLOCK_COUNT];
+    int i;
+
+    run_superblock(board, 100, superblock);
+    run_superblock(board, 0, plain);
+    for (i = 0; i < SUPERBLOCK_COUNT; i++) {
+        g_assert_cmphex(superblock[i], ==, plain[i]);
+        g_assert_cmphex(superblock[i], ==, expected[i]);
+    }
+}
+
+/*
+ * Read FPSCR after an exact addition, an inexact division, another exact
+ * addition and, once FPSCR is cleared, a last exact addition.  The three
+ * values and the quotient end up at RESULTS_BASE.
+ */
+static void run_lazy_fp(const NumworksBoard *board, bool lazy,
+                        uint32_t *results)
+{
+    static const uint8_t firmware[] = {
+        0x00, 0x10, 0x00, 0x20,     /* SP = 0x20001000 */
+        0x09, 0x00, 0x00, 0x08,     /* PC = 0x08000008, Thumb */
+        0x4e, 0xf6, 0x88, 0x50,     /* movw r0, #0xed88 */
+        0xce, 0xf2, 0x00, 0x00,     /* movt r0, #0xe000: CPACR */
+        0x01, 0x68,                 /* ldr r1, [r0] */
+        0x41, 0xf4, 0x70, 0x01,     /* orr r1, r1, #0xf00000: CP10, CP11 */
+        0x01, 0x60,                 /* str r1, [r0] */
+        0xbf, 0xf3, 0x4f, 0x8f,     /* dsb */
+        0xbf, 0xf3, 0x6f, 0x8f,     /* isb */
+        0x40, 0xf2, 0x00, 0x22,     /* movw r2, #0x0200 */
+        0xc2, 0xf2, 0x00, 0x02,     /* movt r2, #0x2000: results */
+        0x00, 0x23,                 /* movs r3, #0 */
+        0xe1, 0xee, 0x10, 0x3a,     /* vmsr fpscr, r3: clear */
+        0xb7, 0xee, 0x00, 0x0a,     /* vmov.f32 s0, #1.0 */
+        0xf0, 0xee, 0x08, 0x0a,     /* vmov.f32 s1, #3.0 */
+        0x30, 0xee, 0x00, 0x1a,     /* vadd.f32 s2, s0, s0: exact */
+        0xf1, 0xee, 0x10, 0x4a,     /* vmrs r4, fpscr */
+        0xc0, 0xee, 0x20, 0x1a,     /* vdiv.f32 s3, s0, s1: inexact */
+        0xf1, 0xee, 0x10, 0x5a,     /* vmrs r5, fpscr */
+        0x30, 0xee, 0x20, 0x1a,     /* vadd.f32 s2, s0, s1 */
+        0xf1, 0xee, 0x10, 0x6a,     /* vmrs r6, fpscr */
+        0xe1, 0xee, 0x10, 0x3a,     /* vmsr fpscr, r3: clear */
+        0x30, 0xee, 0x20, 0x1a,     /* vadd.f32 s2, s0, s1 */
+        0xf1, 0xee, 0x10, 0x7a,     /* vmrs r7, fpscr */
+        0x11, 0xee, 0x90, 0x8a,     /* vmov r8, s3 */
+        0x14, 0x60,                 /* str r4, [r2] */
+        0x55, 0x60,                 /* str r5, [r2, #4] */
+        0x96, 0x60,                 /* str r6, [r2, #8] */
+        0xd7, 0x60,                 /* str r7, [r2, #12] */
+        0xc2, 0xf8, 0x10, 0x80,     /* str r8, [r2, #16] */
+        0x01, 0x23,                 /* movs r3, #1 */
+        0x53, 0x61,                 /* str r3, [r2, #20]: done */
+        0xfe, 0xe7,                 /* b . */
+    };
+    g_autofree char *args = NULL;
+
+    args = g_strdup_printf("-global %s.x-lazy-fp-flags=%s", board->cpu_type,
+                           lazy ? "on" : "off");
+    board_run_firmware(board, args, firmware, sizeof(firmware),
+                       results, LAZY_FP_COUNT);
+}
+
+/* IXC is sticky and cleared by FPSCR writes, whether it is lazy or not */
+static void test_lazy_fp(const void *data)
+{
+    static const uint32_t expected[LAZY_FP_COUNT] = {
+        0, FPSCR_IXC, FPSCR_IXC, 0, 0x3eaaaaab,
+    };
+    const NumworksBoard *board = data;
+    uint32_t lazy[LAZY_FP_COUNT], exact[LAZY_FP_COUNT];
+    int i;
+
+    run_lazy_fp(board, true, lazy);
+    run_lazy_fp(board, false, exact);
+    for (i = 0; i < LAZY_FP_COUNT; i++) {
+        g_assert_cmphex(lazy[i], ==, exact[i]);
+        g_assert_cmphex(lazy[i], ==, expected[i]);
+    }
+}
+
+static void test_budget(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts;
+    QDict *resp, *event, *frame;
+    QList *backtrace;
+
+    qts = board_init_running(board, "-icount shift=0 -machine "
+                             "insn-budget=100000,budget-action=pause");
+
+    resp = qtest_qmp_eventwait_ref(qts, "EXECUTION_BUDGET_EXCEEDED");
+    event = qdict_get_qdict(resp, "data");
+    g_assert_cmpstr(qdict_get_str(event, "budget"), ==, "instructions");
+    g_assert_cmpstr(qdict_get_str(event, "action"), ==, "pause");
+    g_assert_cmpint(qdict_get_int(event, "instructions"), >=, 100000);
+    backtrace = qdict_get_qlist(event, "backtrace");
+    frame = qobject_to(QDict, qlist_peek(backtrace));
+    g_assert_cmphex(qdict_get_int(frame, "pc"), ==, SPIN_PC);
+    qobject_unref(resp);
+    qtest_qmp_eventwait(qts, "STOP");
+
+    qtest_quit(qts);
+}
+
+static void test_budget_shutdown(const void *data)
+{
+    const NumworksBoard *board = data;
+    QTestState *qts;
+    QDict *resp, *event;
+
+    qts = board_init_running(board, "-machine time-budget=1");
+
+    resp = qtest_qmp_eventwait_ref(qts, "EXECUTION_BUDGET_EXCEEDED");
+    event = qdict_get_qdict(resp, "data");
+    g_assert_cmpstr(qdict_get_str(event, "budget"), ==, "time");
+    g_assert_cmpstr(qdict_get_str(event, "action"), ==, "shutdown");
+    g_assert(!qdict_haskey(event, "instructions"));
+    g_assert_cmpint(qdict_get_int(event, "virtual-ns"), >=,
+                    NANOSECONDS_PER_SECOND);
+    qobject_unref(resp);
+    qtest_qmp_eventwait(qts, "SHUTDOWN");
+
+    /* Unlike a guest poweroff, an exhausted budget is a failure */
+    qtest_set_expected_status(qts, 1);
+    qtest_quit(qts);
+}
+
+static void add_board_test(const NumworksBoard *board, const char *name,
+                           void (*fn)(const void *))
+{
+    g_autofree char *path = g_strdup_printf("/numworks/%s/%s",
+                                            board->machine, name);
+
+    qtest_add_data_func(path, board, fn);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(boards); i++) {
+        if (!qtest_has_machine(boards[i].machine)) {
+            continue;
+        }
+        add_board_test(&boards[i], "memory", test_memory);
+        add_board_test(&boards[i], "gpio", test_gpio);
+        add_board_test(&boards[i], "exti", test_exti);
+        add_board_test(&boards[i], "crc", test_crc);
+        add_board_test(&boards[i], "rng", test_rng);
+        add_board_test(&boards[i], "st7789v", test_st7789v);
+        add_board_test(&boards[i], "st7789v-frame-stats",
+                       test_st7789v_frame_stats);
+        add_board_test(&boards[i], "keypad", test_keypad);
+        add_board_test(&boards[i], "tb-stats", test_tb_stats);
+        add_board_test(&boards[i], "bitband", test_bitband);
+        add_board_test(&boards[i], "lazy-fp-flags", test_lazy_fp);
+        add_board_test(&boards[i], "superblock", test_superblock);
+        add_board_test(&boards[i], "budget", test_budget);
+        add_board_test(&boards[i], "budget-shutdown", test_budget_shutdown);
+    }
+
+    return g_test_run();
+}
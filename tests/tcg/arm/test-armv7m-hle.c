@@ -0,0 +1,382 @@
+/*
+ * Test the host emulation of the AEABI double precision routines
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2
+ * or later. See the COPYING file in the top-level directory.
+ */
+
+/*
+ * Print the results of the libgcc soft-float routines and of the libm
+ * functions that the NumWorks machines can emulate in host code, for
+ * edge case operands: NaNs with payloads, signed zeros, subnormals,
+ * infinities, rounding ties and out of range conversions.
+ *
+ * The test runs once with -M n0100,hle=off and once with hle=on, and
+ * both outputs must be identical.  The libm functions are implemented
+ * below, with the NaN behaviour of fdlibm, and take their arguments in
+ * d0 since the test is built for the VFP procedure call standard.
+ */
+
+#include <stdint.h>
+
+#define SRAM_BASE       0x20000000
+#define STACK_SIZE      (16 * 1024)
+#define CPACR           0xe000ed88
+
+#define SYS_WRITE0      0x04
+#define SYS_EXIT        0x18
+
+typedef uint64_t DFn2(uint64_t, uint64_t);
+typedef uint32_t DCmpFn(uint64_t, uint64_t);
+typedef double LibmFn(double);
+
+/* The AEABI routines take doubles in core registers, like 64-bit values */
+DFn2 __aeabi_dadd, __aeabi_dsub, __aeabi_drsub, __aeabi_dmul, __aeabi_ddiv;
+DCmpFn __aeabi_dcmpeq, __aeabi_dcmplt, __aeabi_dcmple, __aeabi_dcmpge,
+    __aeabi_dcmpgt, __aeabi_dcmpun;
+void __aeabi_cdcmple(void);
+void __aeabi_cdrcmple(void);
+uint64_t __aeabi_i2d(int32_t);
+uint64_t __aeabi_ui2d(uint32_t);
+uint64_t __aeabi_l2d(int64_t);
+uint64_t __aeabi_ul2d(uint64_t);
+int32_t __aeabi_d2iz(uint64_t);
+uint32_t __aeabi_d2uiz(uint64_t);
+int64_t __aeabi_d2lz(uint64_t);
+uint64_t __aeabi_d2ulz(uint64_t);
+uint64_t __aeabi_f2d(uint32_t);
+uint32_t __aeabi_d2f(uint64_t);
+
+static const uint64_t doubles[] = {
+    0x0000000000000000ULL,  /* +0 */
+    0x8000000000000000ULL,  /* -0 */
+    0x3ff0000000000000ULL,  /* 1 */
+    0xbff0000000000000ULL,  /* -1 */
+    0x3ff8000000000000ULL,  /* 1.5 */
+    0xc004000000000000ULL,  /* -2.5 */
+    0x3ca0000000000000ULL,  /* 2^-53, half an ulp of 1 */
+    0x3cb8000000000000ULL,  /* 3 * 2^-53 */
+    0x3fb999999999999aULL,  /* 0.1 */
+    0x0000000000000001ULL,  /* smallest subnormal */
+    0x800fffffffffffffULL,  /* largest negative subnormal */
+    0x0010000000000000ULL,  /* smallest normal */
+    0x7fefffffffffffffULL,  /* largest finite */
+    0x41dfffffffe00000ULL,  /* 2^31 - 0.5 */
+    0xc1e0000000000000ULL,  /* -2^31 */
+    0x41f0000000000000ULL,  /* 2^32 */
+    0x43e0000000000000ULL,  /* 2^63 */
+    0xc3f0000000000000ULL,  /* -2^64 */
+    0x7ff0000000000000ULL,  /* +inf */
+    0xfff0000000000000ULL,  /* -inf */
+    0x7ff8000000000001ULL,  /* quiet NaN */
+    0xfff8000000000002ULL,  /* negative quiet NaN */
+    0x7ff0000000000003ULL,  /* signalling NaN */
+    0xfff4000000000000ULL,  /* negative signalling NaN */
+};
+
+static const uint32_t floats[] = {
+    0x00000000, 0x80000000, 0x3f800000, 0x00000001, 0x807fffff,
+    0x7f7fffff, 0x7f800000, 0xff800000, 0x7fc00001, 0xffc00002,
+    0x7f800003, 0xffa00000,
+};
+
+static const uint64_t integers[] = {
+    0, 1, 0xffffffffffffffffULL, 0x7fffffffULL, 0x80000000ULL,
+    0xffffffff80000000ULL, 0x20000000000001ULL, 0x20000000000003ULL,
+    0x7fffffffffffffffULL, 0x8000000000000000ULL, 0x8000000000000400ULL,
+    0xfffffffffffffc00ULL,
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static char line[128];
+static int line_len;
+
+static void semihosting_call(uint32_t op, const void *arg)
+{
+    register uint32_t r0 asm("r0") = op;
+    register const void *r1 asm("r1") = arg;
+
+    asm volatile("bkpt 0xab" : "+r"(r0) : "r"(r1) : "memory");
+}
+
+static void put_str(const char *s)
+{
+    while (*s) {
+        line[line_len++] = *s++;
+    }
+}
+
+static void put_hex(uint64_t v, int digits)
+{
+    line[line_len++] = ' ';
+    while (digits--) {
+        line[line_len++] = "0123456789abcdef"[(v >> (4 * digits)) & 0xf];
+    }
+}
+
+static void put_line(void)
+{
+    line[line_len++] = '\n';
+    line[line_len] = 0;
+    semihosting_call(SYS_WRITE0, line);
+    line_len = 0;
+}
+
+/* Call a flag-returning comparison and return NZCV */
+static uint32_t call_cdcmp(void (*fn)(void), uint64_t a, uint64_t b)
+{
+    register uint32_t r0 asm("r0") = a;
+    register uint32_t r1 asm("r1") = a >> 32;
+    register uint32_t r2 asm("r2") = b;
+    register uint32_t r3 asm("r3") = b >> 32;
+    uint32_t psr;
+
+    asm volatile("blx %5\n\t"
+                 "mrs %4, apsr"
+                 : "+r"(r0), "+r"(r1), "+r"(r2), "+r"(r3), "=r"(psr)
+                 : "r"(fn)
+                 : "ip", "lr", "cc", "memory");
+    return psr >> 28;
+}
+
+static uint64_t to_bits(double d)
+{
+    union { double d; uint64_t u; } x = { .d = d };
+
+    return x.u;
+}
+
+static double from_bits(uint64_t u)
+{
+    union { double d; uint64_t u; } x = { .u = u };
+
+    return x.d;
+}
+
+/* Quiet a NaN argument, as x + x or x * x + x would */
+static double quiet(uint64_t u)
+{
+    return from_bits(u | 1ULL << 51);
+}
+
+/* @dir is 0 to round towards zero, -1 for floor and 1 for ceil */
+static double round_int(double x, int dir)
+{
+    uint64_t u = to_bits(x);
+    int e = (int)(u >> 52 & 0x7ff) - 0x3ff;
+    int away = dir && (dir < 0) == (int)(u >> 63);
+    uint64_t m;
+
+    if (e >= 52) {
+        return e == 0x400 && (u << 12) ? quiet(u) : x;
+    }
+    if (e < 0) {
+        if (!(u << 1)) {
+            return x;
+        }
+        u &= 1ULL << 63;
+        return from_bits(away ? u | 0x3ff0000000000000ULL : u);
+    }
+    m = (1ULL << (52 - e)) - 1;
+    if (!(u & m)) {
+        return x;
+    }
+    if (away) {
+        u += m + 1;
+    }
+    return from_bits(u & ~m);
+}
+
+double floor(double x)
+{
+    return round_int(x, -1);
+}
+
+double ceil(double x)
+{
+    return round_int(x, 1);
+}
+
+double trunc(double x)
+{
+    return round_int(x, 0);
+}
+
+/* Digit by digit square root, rounded to nearest */
+double sqrt(double x)
+{
+    uint64_t u = to_bits(x);
+    uint64_t m = u & ((1ULL << 52) - 1);
+    uint64_t q = 0, r = 0, t;
+    int e = u >> 52 & 0x7ff;
+    int i, k;
+
+    if (e == 0x7ff && m) {
+        return quiet(u);
+    }
+    if (!(u << 1)) {
+        return x;
+    }
+    if (u >> 63) {
+        return from_bits(0x7ff8000000000000ULL);
+    }
+    if (e == 0x7ff) {
+        return x;
+    }
+
+    /* x = m * 2^(e - 1075), with m normalized and an even exponent */
+    if (e) {
+        m |= 1ULL << 52;
+    } else {
+        e = 1;
+        while (!(m & 1ULL << 52)) {
+            m <<= 1;
+            e--;
+        }
+    }
+    if ((e - 1075) & 1) {
+        m <<= 1;
+        e--;
+    }
+    k = (e - 1075) / 2;
+
+    /* q = floor(sqrt(m * 2^52)), with 53 significant bits */
+    for (i = 52; i >= 0; i--) {
+        r = r << 2 | (2 * i >= 52 ? m >> (2 * i - 52) & 3 : 0);
+        t = q << 2 | 1;
+        q <<= 1;
+        if (r >= t) {
+            r -= t;
+            q |= 1;
+        }
+    }
+    /* There are no ties: round up if sqrt(m * 2^52) > q + 0.5 */
+    if (r > q) {
+        q++;
+    }
+    return from_bits(((uint64_t)(k + 26 + 1022) << 52) + q);
+}
+
+static LibmFn *const libm_fns[] = { sqrt, floor, ceil, trunc };
+static const char *const libm_names[] = { "sqrt", "floor", "ceil", "trunc" };
+
+static void test_arith(const char *name, DFn2 *fn)
+{
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(doubles); i++) {
+        for (j = 0; j < ARRAY_SIZE(doubles); j++) {
+            put_str(name);
+            put_hex(doubles[i], 16);
+            put_hex(doubles[j], 16);
+            put_hex(fn(doubles[i], doubles[j]), 16);
+            put_line();
+        }
+    }
+}
+
+static void test_compare(void)
+{
+    static DCmpFn *const fns[] = {
+        __aeabi_dcmpeq, __aeabi_dcmplt, __aeabi_dcmple,
+        __aeabi_dcmpge, __aeabi_dcmpgt, __aeabi_dcmpun,
+    };
+    int i, j, k;
+
+    for (i = 0; i < ARRAY_SIZE(doubles); i++) {
+        for (j = 0; j < ARRAY_SIZE(doubles); j++) {
+            put_str("cmp");
+            put_hex(doubles[i], 16);
+            put_hex(doubles[j], 16);
+            for (k = 0; k < ARRAY_SIZE(fns); k++) {
+                put_hex(fns[k](doubles[i], doubles[j]), 1);
+            }
+            put_hex(call_cdcmp(__aeabi_cdcmple, doubles[i], doubles[j]), 1);
+            put_hex(call_cdcmp(__aeabi_cdrcmple, doubles[i], doubles[j]), 1);
+            put_line();
+        }
+    }
+}
+
+static void test_convert(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(doubles); i++) {
+        put_str("d2x");
+        put_hex(doubles[i], 16);
+        put_hex(__aeabi_d2iz(doubles[i]), 8);
+        put_hex(__aeabi_d2uiz(doubles[i]), 8);
+        put_hex(__aeabi_d2lz(doubles[i]), 16);
+        put_hex(__aeabi_d2ulz(doubles[i]), 16);
+        put_hex(__aeabi_d2f(doubles[i]), 8);
+        put_line();
+    }
+    for (i = 0; i < ARRAY_SIZE(floats); i++) {
+        put_str("f2d");
+        put_hex(floats[i], 8);
+        put_hex(__aeabi_f2d(floats[i]), 16);
+        put_line();
+    }
+    for (i = 0; i < ARRAY_SIZE(integers); i++) {
+        put_str("x2d");
+        put_hex(integers[i], 16);
+        put_hex(__aeabi_i2d(integers[i]), 16);
+        put_hex(__aeabi_ui2d(integers[i]), 16);
+        put_hex(__aeabi_l2d(integers[i]), 16);
+        put_hex(__aeabi_ul2d(integers[i]), 16);
+        put_line();
+    }
+}
+
+static void test_libm(void)
+{
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(libm_fns); i++) {
+        /* Keep the compiler from inlining or folding the call */
+        LibmFn *volatile fn = libm_fns[i];
+
+        for (j = 0; j < ARRAY_SIZE(doubles); j++) {
+            put_str(libm_names[i]);
+            put_hex(doubles[j], 16);
+            put_hex(to_bits(fn(from_bits(doubles[j]))), 16);
+            put_line();
+        }
+    }
+}
+
+static void __attribute__((noinline)) run_tests(void)
+{
+    line_len = 0;
+    test_arith("dadd", __aeabi_dadd);
+    test_arith("dsub", __aeabi_dsub);
+    test_arith("drsub", __aeabi_drsub);
+    test_arith("dmul", __aeabi_dmul);
+    test_arith("ddiv", __aeabi_ddiv);
+    test_compare();
+    test_convert();
+    test_libm();
+}
+
+void __attribute__((noreturn)) reset(void)
+{
+    static const uint32_t exit_code = 0x20026; /* ApplicationExit */
+
+    /* Enable CP10 and CP11 before any FP insn */
+    *(volatile uint32_t *)CPACR |= 0xf << 20;
+    asm volatile("dsb\n\tisb" : : : "memory");
+
+    run_tests();
+
+    semihosting_call(SYS_EXIT, (const void *)exit_code);
+    for (;;) {
+    }
+}
+
+__attribute__((section(".vectors"), used))
+static const uintptr_t vectors[] = {
+    SRAM_BASE + STACK_SIZE,
+    (uintptr_t)reset,
+};
@@ -0,0 +1,143 @@
+/*
+ * Startup profiling
+ *
+ * Reports where the time goes between the start of the process and the
+ * moment the guest is ready to run: each phase of qemu_init(), the
+ * realize of each device type and the memory transaction commits, which
+ * rebuild the flat views.  Realize times are inclusive, so a SoC also
+ * accounts for the devices it realizes.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/startup-profile.h"
+#include "qemu/timer.h"
+
+typedef struct StartupProfileEntry {
+    const char *name;
+    uint64_t count;
+    int64_t ns;
+} StartupProfileEntry;
+
+static const char *const kind_title[STARTUP_PROFILE__MAX] = {
+    [STARTUP_PROFILE_REALIZE] = "device realize",
+    [STARTUP_PROFILE_COMMIT] = "memory commit, by phase",
+};
+
+bool startup_profile_enabled;
+
+static int64_t phase_start;
+static int64_t init_start;
+static bool reported;
+static GArray *phases;
+static GHashTable *tables[STARTUP_PROFILE__MAX];
+
+static void phase_end(int64_t now)
+{
+    if (phases->len) {
+        g_array_index(phases, StartupProfileEntry, phases->len - 1).ns =
+            now - phase_start;
+    }
+    phase_start = now;
+}
+
+void startup_profile_init(void)
+{
+    init_start = phase_start = get_clock();
+    phases = g_array_new(false, false, sizeof(StartupProfileEntry));
+}
+
+void startup_profile_phase(const char *name)
+{
+    StartupProfileEntry e = { .name = name, .count = 1 };
+
+    if (!phases || reported) {
+        return;
+    }
+
+    phase_end(get_clock());
+    g_array_append_val(phases, e);
+}
+
+void startup_profile_account(StartupProfileKind kind, const char *name,
+                             int64_t ns)
+{
+    StartupProfileEntry *e;
+
+    if (!name) {
+        name = phases && phases->len ?
+            g_array_index(phases, StartupProfileEntry, phases->len - 1).name :
+            "startup";
+    }
+    if (!tables[kind]) {
+        tables[kind] = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             NULL, g_free);
+    }
+    e = g_hash_table_lookup(tables[kind], name);
+    if (!e) {
+        e = g_new0(StartupProfileEntry, 1);
+        e->name = name;
+        g_hash_table_insert(tables[kind], (gpointer)name, e);
+    }
+    e->count++;
+    e->ns += ns;
+}
+
+static int entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const StartupProfileEntry *ea = a, *eb = b;
+
+    return ea->ns < eb->ns ? 1 : ea->ns > eb->ns ? -1 : 0;
+}
+
+static void report_table(StartupProfileKind kind)
+{
+    g_autoptr(GList) entries = NULL;
+    GList *l;
+
+    if (!tables[kind]) {
+        return;
+    }
+
+    error_printf("  %-40s %8s %10s\n", kind_title[kind], "count", "ms");
+    entries = g_list_sort(g_hash_table_get_values(tables[kind]), entry_cmp);
+    for (l = entries; l; l = l->next) {
+        StartupProfileEntry *e = l->data;
+
+        error_printf("  %-40s %8" PRIu64 " %10.3f\n",
+                     e->name, e->count, e->ns / 1e6);
+    }
+}
+
+void startup_profile_report(void)
+{
+    int64_t total;
+    int i;
+
+    if (reported) {
+        return;
+    }
+    reported = true;
+    if (!startup_profile_enabled) {
+        return;
+    }
+    startup_profile_enabled = false;
+    total = get_clock() - init_start;
+    phase_end(init_start + total);
+
+    error_printf("startup profile:\n");
+    error_printf("  %-40s %8s %10s\n", "phase", "", "ms");
+    for (i = 0; i < phases->len; i++) {
+        StartupProfileEntry *e = &g_array_index(phases, StartupProfileEntry, i);
+
+        error_printf("  %-40s %8s %10.3f\n", e->name, "", e->ns / 1e6);
+    }
+    error_printf("  %-40s %8s %10.3f\n", "total", "", total / 1e6);
+
+    for (i = 0; i < STARTUP_PROFILE__MAX; i++) {
+        report_table(i);
+    }
+}